@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <new>
+
+
+// Allocation policies for the containers in LinkedList.hpp and UnrolledList.hpp.
+// A policy creates and destroys objects of a single type U. release() frees
+// everything the policy still holds without calling destructors, and
+// adopt() takes over the memory of another policy of the same type.
+
+
+/* Plain new/delete for every object. */
+template<typename U> class heapAllocator {
+public:
+  static constexpr bool bulkRelease = false;
+
+  template<typename... Args>
+  U* create(Args&&... args) {
+    return new U(std::forward<Args>(args)...);
+  }
+
+  void destroy(U* const ptr) {
+    delete ptr;
+  }
+
+  void release() {}
+  void adopt(heapAllocator& other) {}
+  void swap(heapAllocator& other) {}
+};
+
+
+/* Hands out objects from slabs of slots. Destroyed objects are recycled
+   through a free list, and release() frees all slabs at once. */
+template<typename U> class poolAllocator {
+private:
+  union slot {
+    slot* next;
+    alignas(U) unsigned char storage[sizeof(U)];
+  };
+
+  // Slabs double in size up to maxSlabSize slots
+  static constexpr size_t minSlabSize = 32;
+  static constexpr size_t maxSlabSize = 4096;
+
+  std::vector<slot*> slabs;
+  slot* freeList;
+  slot* slabPos;
+  slot* slabEnd;
+  size_t nextSlabSize;
+
+  slot* _allocate() {
+    if(freeList != nullptr) {
+      slot* s = freeList;
+      freeList = s->next;
+      return s;
+    }
+
+    if(slabPos == slabEnd) {
+      slabPos = new slot[nextSlabSize];
+      slabEnd = slabPos + nextSlabSize;
+      slabs.push_back(slabPos);
+      if(nextSlabSize < maxSlabSize) {
+        nextSlabSize *= 2;
+      }
+    }
+    return slabPos++;
+  }
+
+public:
+  static constexpr bool bulkRelease = true;
+
+  poolAllocator() : freeList(nullptr), slabPos(nullptr), slabEnd(nullptr), nextSlabSize(minSlabSize) {}
+
+  // Objects are owned by the container using the pool, so pools are never copied
+  poolAllocator(const poolAllocator& other) : poolAllocator() {}
+  poolAllocator& operator=(const poolAllocator& other) { return *this; }
+
+  ~poolAllocator() {
+    release();
+  }
+
+  template<typename... Args>
+  U* create(Args&&... args) {
+    slot* s = _allocate();
+    return new(s->storage) U(std::forward<Args>(args)...);
+  }
+
+  void destroy(U* const ptr) {
+    if(ptr == nullptr) return;
+
+    ptr->~U();
+    slot* s = reinterpret_cast<slot*>(ptr);
+    s->next = freeList;
+    freeList = s;
+  }
+
+  void release() {
+    for(slot* slab : slabs) {
+      delete[] slab;
+    }
+    slabs.clear();
+    freeList = nullptr;
+    slabPos = nullptr;
+    slabEnd = nullptr;
+    nextSlabSize = minSlabSize;
+  }
+
+  // Takes ownership of other's slabs. Its free slots are not reused until release().
+  void adopt(poolAllocator& other) {
+    if(this == &other) return;
+
+    slabs.insert(slabs.end(), other.slabs.begin(), other.slabs.end());
+    other.slabs.clear();
+    other.freeList = nullptr;
+    other.slabPos = nullptr;
+    other.slabEnd = nullptr;
+    other.nextSlabSize = minSlabSize;
+  }
+
+  void swap(poolAllocator& other) {
+    std::swap(slabs, other.slabs);
+    std::swap(freeList, other.freeList);
+    std::swap(slabPos, other.slabPos);
+    std::swap(slabEnd, other.slabEnd);
+    std::swap(nextSlabSize, other.nextSlabSize);
+  }
+};
@@ -1,11 +1,20 @@
 #include <string>
 #include <vector>
+#include <array>
+#include <utility>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 #include <exception>
 #include <fstream>
 
 #include "LinkedList.hpp"
 #include "StringFunctions.hpp"
+#include "PhonemeClassTable.hpp"
+#include "Histogram.hpp"
+#include "Reduction.hpp"
+#include "ColumnarFile.hpp"
+#include "Metrics.hpp"
 
 #include "Parser.cpp"
 
@@ -42,7 +51,7 @@ public:
 
 private:
   std::string filePath;
-  list<Info> data;
+  list<Info, poolAllocator> data;
 
 public:
   Phonemes() : filePath("Phonemes.txt") {}
@@ -58,32 +67,77 @@ public:
   void setPath(const std::string& path) { filePath = path; }
 
   int size() const { return data.size(); }
-  const list<Info>& getData() const { return data; }
+  const list<Info, poolAllocator>& getData() const { return data; }
   const Info& getInfoAt(const int& i) const { return data.at(i); }
+  // For callers that look records up by position, which then takes O(log n)
+  void setIndexed(const bool& enable) { data.setIndexed(enable); }
 
+  // Large syllable lists are counted in parts on the shared thread pool
   void count(const Syllables& syllables) {
-    std::unordered_map<char,int> phonemeCounts;
-
+    Metrics::Timer timer("Phonemes::count");
     data.clear();
 
-    const list<Syllables::Info>& sylList = syllables.getData();
-    for(const Syllables::Info& i : sylList) {
-      for(const char& p : i.pronunciation) {
-        phonemeCounts[p] += i.freqCount;
+    const Histogram phonemeCounts = syllables.getData().reduce(Histogram(),
+      [](Histogram& counts, const Syllables::Info& i) { counts.add(i.pronunciation(), i.freqCount); },
+      [](Histogram& counts, const Histogram& other) { counts.merge(other); });
+
+    // Every phoneme that appears, in byte order
+    for(int c = 0; c < 256; ++c) {
+      if(phonemeCounts.count((char)c) > 0) {
+        data.emplace_back((char)c, (int)phonemeCounts.total((char)c));
       }
     }
+  }
 
-    for(const std::pair<char, int>& i : phonemeCounts) {
-      data.add(Info(i.first, i.second));
+  // Updates counts made by count(), or read back from the file, for the
+  // syllables that changed (see Syllables::applyDelta())
+  void update(const std::vector<Syllables::Change>& changes) {
+    Metrics::Timer timer("Phonemes::update");
+    long long totals[256] = {};
+    for(const Info& i : data) {
+      totals[(unsigned char)i.sound] += i.freqCount;
+    }
+
+    for(const Syllables::Change& c : changes) {
+      for(const char& p : SymbolTable::pronunciations().name(c.id)) {
+        totals[(unsigned char)p] += (long long)c.after - c.before;
+      }
+    }
+
+    // Syllables in the list are always counted, so a phoneme appears exactly if its count isn't 0
+    data.clear();
+    for(int c = 0; c < 256; ++c) {
+      if(totals[c] != 0) {
+        data.emplace_back((char)c, (int)totals[c]);
+      }
     }
   }
 
   void sort() {
-    auto compare = [&](const Info& a, const Info& b) { return a.freqCount > b.freqCount; };
-    data.sort(compare);
+    Metrics::Timer timer("Phonemes::sort");
+    data.sortByKey([](const Info& i) { return i.freqCount; }, true);
+  }
+
+  // Reads counts written by write()
+  void read() {
+    Metrics::Timer timer("Phonemes::read");
+    MappedFile file(filePath);
+    if(!file.isOpen()) {
+      throw std::invalid_argument("File path not valid.");
+    }
+
+    Metrics::shared().add("bytes read", file.size());
+    RecordReader reader(file.view());
+    reader.setDelimiter(deliminator);
+    std::vector<std::string_view> segments;
+    clear();
+    while(reader.next(segments, 2)) {
+      data.emplace_back(std::string(segments[0]), std::string(segments[1]));
+    }
   }
 
   void write() const {
+    Metrics::Timer timer("Phonemes::write");
     std::ofstream file(filePath);
     if(file.is_open()) {
       file << "## This file was generated by code using data from another file." << std::endl;
@@ -94,6 +148,7 @@ public:
         file << i.toString(deliminator) << std::endl;
       }
 
+      Metrics::shared().add("bytes written", (int64_t)file.tellp());
       file.close();
     } else {
       throw std::invalid_argument("File path not valid.");
@@ -108,10 +163,14 @@ public:
   public:
     std::string blend;
     int freqCount;
+    int onsetCount; // Where the blend starts the syllable
+    int codaCount; // Where it ends the syllable after some other phoneme
+    int first; // ID of the first syllable in the list that has it, -1 if not known
 
-    Info(const std::string& blend, const int& freqCount) : blend(blend), freqCount(freqCount) {}
+    Info(const std::string& blend, const int& freqCount) : blend(blend), freqCount(freqCount), onsetCount(0), codaCount(0), first(-1) {}
+    Info(const std::string& blend, const int& freqCount, const int& onsetCount, const int& codaCount, const int& first = -1) : blend(blend), freqCount(freqCount), onsetCount(onsetCount), codaCount(codaCount), first(first) {}
 
-    Info(const std::string& blendSeg, const std::string& freqSeg) {
+    Info(const std::string& blendSeg, const std::string& freqSeg) : onsetCount(0), codaCount(0), first(-1) {
       blend = blendSeg;
       if(!StringFunctions::isInteger(freqSeg)) throw std::invalid_argument("freqSeg argument of Info is not an integer.");
       freqCount = std::stoi(freqSeg);
@@ -127,8 +186,165 @@ public:
   };
 
 private:
+  // Trie of consonant runs, walked one consonant at a time, so nothing is
+  // built or hashed per run. Node 0 is the empty run.
+  class BlendTrie {
+  public:
+    class Node {
+    public:
+      long long freqCount = 0;
+      long long onsetCount = 0;
+      long long codaCount = 0;
+      bool listed = false;
+    };
+
+    const PhonemeClassTable* consonants;
+    size_t n;
+    std::vector<Node> nodes;
+    std::vector<int> children; // Child of node i for consonant c is at i * n + c, 0 if none
+    std::vector<int> order; // Nodes of blends in the order they first appear
+    std::vector<std::string> blends; // Matching order
+    std::vector<int> firsts; // Syllable each first appears in, matching order
+
+    BlendTrie(const PhonemeClassTable& consonants) : consonants(&consonants), n(consonants.size()), nodes(1), children(n, 0) {}
+
+    int child(const int node, const int c) {
+      int next = children[node * n + c];
+      if(next == 0) {
+        next = (int)nodes.size();
+        nodes.emplace_back();
+        children.resize(children.size() + n, 0);
+        children[node * n + c] = next;
+      }
+      return next;
+    }
+
+    // Lists the blend ending at node if it isn't yet
+    Node& entry(const int node, std::string_view blend, const int& syllable) {
+      Node& result = nodes[node];
+      if(!result.listed) {
+        result.listed = true;
+        order.push_back(node);
+        blends.emplace_back(blend);
+        firsts.push_back(syllable);
+      }
+      return result;
+    }
+
+    // Counts the blends of syllable id
+    void add(const int& id, std::string_view pron, const int& freqCount) {
+      for(size_t j = 0; j < pron.length();) {
+        const size_t start = j;
+        int node = 0;
+        for(; j < pron.length(); ++j) {
+          const int c = consonants->index(pron[j]);
+          if(c < 0) break;
+          node = child(node, c);
+        }
+
+        if(j - start > 1) {
+          Node& blend = entry(node, pron.substr(start, j - start), id);
+          blend.freqCount += freqCount;
+          if(start == 0) {
+            blend.onsetCount += freqCount;
+          } else if(j == pron.length()) {
+            blend.codaCount += freqCount;
+          }
+        }
+
+        if(j == start) {
+          ++j;
+        }
+      }
+    }
+
+    // Adds the counts of other as if its syllables came after these ones
+    void merge(const BlendTrie& other) {
+      for(size_t j = 0; j < other.order.size(); ++j) {
+        int node = 0;
+        for(const char& c : other.blends[j]) {
+          node = child(node, consonants->index(c));
+        }
+
+        const Node& counts = other.nodes[other.order[j]];
+        Node& blend = entry(node, other.blends[j], other.firsts[j]);
+        blend.freqCount += counts.freqCount;
+        blend.onsetCount += counts.onsetCount;
+        blend.codaCount += counts.codaCount;
+      }
+    }
+  };
+
   std::string filePath;
-  list<Info> data;
+  list<Info, poolAllocator> data;
+
+  /* Cache columns: blend strings (0, 1), counts (2), onset counts (3), coda
+     counts (4) and the first syllable with each (5, 6) */
+  static constexpr uint32_t cacheKind = 4;
+
+  void _writeCache() const {
+    std::vector<std::string_view> blends;
+    std::vector<int32_t> freqs;
+    std::vector<int32_t> onsets;
+    std::vector<int32_t> codas;
+    std::vector<std::string_view> firsts;
+    for(const Info& i : data) {
+      blends.push_back(i.blend);
+      freqs.push_back(i.freqCount);
+      onsets.push_back(i.onsetCount);
+      codas.push_back(i.codaCount);
+      firsts.push_back(i.first < 0 ? std::string_view() : SymbolTable::pronunciations().name(i.first));
+    }
+
+    Columnar::Writer writer(cacheKind, data.size());
+    writer.addStrings(blends);
+    writer.addInts(freqs);
+    writer.addInts(onsets);
+    writer.addInts(codas);
+    writer.addStrings(firsts);
+    writer.write(Columnar::cachePath(filePath), filePath);
+  }
+
+  // Calls f(start, end) for every run of two or more consonants in pron
+  template<typename Function>
+  static void _forEachRun(std::string_view pron, const PhonemeClassTable& consonants, Function f) {
+    for(size_t j = 0; j < pron.length();) {
+      const size_t start = j;
+      while(j < pron.length() && consonants.index(pron[j]) >= 0) {
+        ++j;
+      }
+      if(j - start > 1) {
+        f(start, j);
+      }
+      if(j == start) {
+        ++j;
+      }
+    }
+  }
+
+  // Where blend first appears in syllable id, or npos if it doesn't
+  static size_t _find(const int& id, const std::string& blend, const PhonemeClassTable& consonants) {
+    std::string_view pron = SymbolTable::pronunciations().name(id);
+    size_t result = std::string_view::npos;
+    _forEachRun(pron, consonants, [&](const size_t start, const size_t end) {
+      if(result == std::string_view::npos && pron.substr(start, end - start) == blend) {
+        result = start;
+      }
+    });
+    return result;
+  }
+
+  // Whether blend a is listed before blend b, which count() leaves in the
+  // order they first appear and sort() by count, with ties the other way around
+  static bool _before(const Info& a, const Info& b, const Syllables& syllables, const PhonemeClassTable& consonants) {
+    if(a.freqCount != b.freqCount) {
+      return a.freqCount > b.freqCount;
+    }
+    if(a.first != b.first) {
+      return syllables.comesBefore(b.first, a.first);
+    }
+    return _find(b.first, b.blend, consonants) < _find(a.first, a.blend, consonants);
+  }
 
 public:
   Blends() : filePath("Blends.txt") {}
@@ -144,45 +360,150 @@ public:
   void setPath(const std::string& path) { filePath = path; }
 
   int size() const { return data.size(); }
-  const list<Info>& getData() const { return data; }
+  const list<Info, poolAllocator>& getData() const { return data; }
   const Info& getInfoAt(const int& i) const { return data.at(i); }
+  // For callers that look records up by position, which then takes O(log n)
+  void setIndexed(const bool& enable) { data.setIndexed(enable); }
+
+  // Counts every run of two or more consonants. Blends are listed in the
+  // order they first appear. Large syllable lists are counted in parts on
+  // the shared thread pool.
+  void count(const Syllables& syllables, const PhonemeClassTable& consonants) {
+    Metrics::Timer timer("Blends::count");
+    data.clear();
 
-  void count(const Syllables& syllables, const std::string& consonants) {
-    std::unordered_map<std::string,int> blendCounts;
+    const BlendTrie trie = syllables.getData().reduce(BlendTrie(consonants),
+      [](BlendTrie& trie, const Syllables::Info& i) { trie.add(i.id, i.pronunciation(), i.freqCount); },
+      [](BlendTrie& trie, const BlendTrie& other) { trie.merge(other); });
 
-    data.clear();
+    for(size_t j = 0; j < trie.order.size(); ++j) {
+      const BlendTrie::Node& blend = trie.nodes[trie.order[j]];
+      data.emplace_back(trie.blends[j], (int)blend.freqCount, (int)blend.onsetCount, (int)blend.codaCount, trie.firsts[j]);
+    }
+  }
 
-    std::string blend;
-    const list<Syllables::Info>& sylList = syllables.getData();
-    for(const Syllables::Info& i : sylList) {
-      for(const char& p : i.pronunciation) {
-        if(StringFunctions::contains(consonants, p)) {
-          blend += p;
+  /* Updates counts made by count() and sort(), or read back with read(),
+     for the syllables that changed (see Syllables::applyDelta()), where
+     syllables holds the list after the changes. The list ends up the way
+     count() and sort() would leave it.
+     Blends with the same count are listed by the first syllable that has
+     them, which is kept for each one and written to the cache. Only the
+     blends of the changed syllables are taken out of the list and put back
+     in with a binary search. Finding the first syllable with one again only
+     passes over syllables when its old one changed, from where that was to
+     the next syllable with the blend. */
+  void update(const std::vector<Syllables::Change>& changes, const Syllables& syllables, const PhonemeClassTable& consonants) {
+    Metrics::Timer timer("Blends::update");
+    SymbolTable& table = SymbolTable::pronunciations();
+
+    // A blend of a changed syllable: how much its counts changed, and the
+    // first changed syllable in the list that still has it
+    class Pending {
+    public:
+      long long freqCount = 0;
+      long long onsetCount = 0;
+      long long codaCount = 0;
+      int first = -1;
+      Info* listed = nullptr; // Its entry before the changes, if it had one
+    };
+    std::unordered_map<std::string, Pending> pending;
+    std::vector<std::string> blends; // Of pending, in the order they are found
+    std::unordered_map<int, const Syllables::Change*> changed;
+
+    for(const Syllables::Change& c : changes) {
+      changed.emplace(c.id, &c);
+      std::string_view pron = table.name(c.id);
+      const long long amount = (long long)c.after - c.before;
+      _forEachRun(pron, consonants, [&](const size_t start, const size_t end) {
+        const std::string blend(pron.substr(start, end - start));
+        const auto entry = pending.emplace(blend, Pending());
+        if(entry.second) {
+          blends.push_back(blend);
+        }
+
+        Pending& p = entry.first->second;
+        p.freqCount += amount;
+        if(start == 0) {
+          p.onsetCount += amount;
+        } else if(end == pron.length()) {
+          p.codaCount += amount;
+        }
+        if(c.after > 0 && (p.first < 0 || syllables.comesBefore(c.id, p.first))) {
+          p.first = c.id;
+        }
+      });
+    }
+
+    // Taken out in one pass, kept until they are put back
+    std::vector<Info> taken;
+    taken.reserve(pending.size());
+    for(list<Info, poolAllocator>::iterator i = data.begin(); i != data.end();) {
+      if(pending.count(i->blend) > 0) {
+        taken.push_back(*i);
+        data.remove(i);
+      } else {
+        ++i;
+      }
+    }
+    for(Info& i : taken) {
+      pending[i.blend].listed = &i;
+    }
+
+    data.setIndexed(true);
+    for(const std::string& blend : blends) {
+      const Pending& p = pending[blend];
+      Info info(blend, (int)p.freqCount, (int)p.onsetCount, (int)p.codaCount, p.first);
+      if(p.listed != nullptr) {
+        info.freqCount += p.listed->freqCount;
+        info.onsetCount += p.listed->onsetCount;
+        info.codaCount += p.listed->codaCount;
+      }
+      if(info.freqCount <= 0) continue;
+
+      // The syllables that didn't change and have it all come after its old first one
+      if(p.listed != nullptr) {
+        const int old = p.listed->first;
+        const auto c = changed.find(old);
+        if(old >= 0 && c == changed.end()) {
+          if(info.first < 0 || syllables.comesBefore(old, info.first)) {
+            info.first = old;
+          }
         } else {
-          if(blend.length() > 1) {
-            blendCounts[blend] += i.freqCount;
+          const Syllables::Change* before = old < 0 ? nullptr : c->second;
+          const size_t from = (before == nullptr || before->firstBefore.index < 0) ? 0 : syllables.position(before->before, before->firstBefore);
+          if(from < (size_t)syllables.size()) {
+            for(unrolledList<Syllables::Info, poolAllocator>::const_iterator i = syllables.getData().begin() + from; i != syllables.getData().end(); ++i) {
+              if(info.first >= 0 && !syllables.comesBefore(i->id, info.first)) break;
+              if(_find(i->id, blend, consonants) != std::string_view::npos) {
+                info.first = i->id;
+                break;
+              }
+            }
           }
-          blend = "";
         }
       }
 
-      if(blend.length() > 1) {
-        blendCounts[blend] += i.freqCount;
+      size_t low = 0;
+      size_t high = data.size();
+      while(low < high) {
+        const size_t mid = low + (high - low) / 2;
+        if(_before(data[mid], info, syllables, consonants)) {
+          low = mid + 1;
+        } else {
+          high = mid;
+        }
       }
-      blend = "";
-    }
-
-    for(const std::pair<std::string, int>& i : blendCounts) {
-      data.add(Info(i.first, i.second));
+      data.insert(low, info);
     }
   }
 
   void sort() {
-    auto compare = [&](const Info& a, const Info& b) { return a.freqCount > b.freqCount; };
-    data.sort(compare);
+    Metrics::Timer timer("Blends::sort");
+    data.sortByKey([](const Info& i) { return i.freqCount; }, true);
   }
 
   void write() const {
+    Metrics::Timer timer("Blends::write");
     std::ofstream file(filePath);
     if(file.is_open()) {
       file << "## This file was generated by code using data from another file." << std::endl;
@@ -193,11 +514,179 @@ public:
         file << i.toString(deliminator) << std::endl;
       }
 
+      Metrics::shared().add("bytes written", (int64_t)file.tellp());
+      file.close();
+    } else {
+      throw std::invalid_argument("File path not valid.");
+    }
+  }
+
+  // Loads the counts from the cache write() leaves next to the file when
+  // cache is set
+  void read() {
+    Metrics::Timer timer("Blends::read");
+    Columnar::Reader cache(Columnar::cachePath(filePath), cacheKind, filePath);
+    const size_t records = cache.isValid() ? cache.records() : 0;
+    Columnar::Strings blends;
+    Columnar::Strings firsts;
+    const int32_t* freqs;
+    const int32_t* onsets;
+    const int32_t* codas;
+    if(!cache.isValid() || !cache.strings(0, blends) || blends.size() != records || !cache.ints(2, records, freqs) || !cache.ints(3, records, onsets) || !cache.ints(4, records, codas) || !cache.strings(5, firsts) || firsts.size() != records) {
+      throw std::runtime_error("No up to date cache of the counts in " + filePath + ", they have to be counted again.");
+    }
+
+    data.clear();
+    for(size_t i = 0; i < records; ++i) {
+      const int first = firsts[i].empty() ? -1 : SymbolTable::pronunciations().intern(firsts[i]);
+      data.emplace_back(std::string(blends[i]), freqs[i], onsets[i], codas[i], first);
+    }
+    Metrics::shared().add("records read", records);
+  }
+
+  // Also writes how often each blend starts or ends a syllable. If cache
+  // is set, the counts are also written where read() can load them.
+  void write(const bool& onset, const bool& coda, const bool& cache = false) const {
+    Metrics::Timer timer("Blends::write");
+    std::ofstream file(filePath);
+    if(file.is_open()) {
+      file << "## This file was generated by code using data from another file." << std::endl;
+      file << std::endl;
+
+      std::string firstLine = std::string("Blend") + deliminator + "Count";
+      if(onset) {
+        firstLine += std::string() + deliminator + "Onset";
+      }
+      if(coda) {
+        firstLine += std::string() + deliminator + "Coda";
+      }
+      file << firstLine << std::endl;
+
+      for(const Info& i : data) {
+        std::string line = i.toString(deliminator);
+        if(onset) {
+          line += (deliminator + std::to_string(i.onsetCount));
+        }
+        if(coda) {
+          line += (deliminator + std::to_string(i.codaCount));
+        }
+        file << line << std::endl;
+      }
+
+      Metrics::shared().add("bytes written", (int64_t)file.tellp());
       file.close();
     } else {
       throw std::invalid_argument("File path not valid.");
     }
+
+    if(cache) {
+      _writeCache();
+    }
+  }
+};
+
+
+/* Groups syllables that are the same apart from one phoneme, replaced at
+   some of its positions. Each syllable is stored under every pattern it
+   matches: itself with some of the positions holding the same phoneme
+   turned into wildcards. Two syllables are substitution partners exactly
+   when they share a pattern, so every partner of a syllable is found in
+   one bucket without building any candidate strings. */
+class Substitutions {
+public:
+  class Entry {
+  public:
+    char phoneme; // At the wildcard positions
+    int freqCount;
+
+    Entry(const char& phoneme, const int& freqCount) : phoneme(phoneme), freqCount(freqCount) {}
+  };
+
+  // Replacing every occurrence of phoneme in a syllable gives the partners
+  class Query {
+  public:
+    char phoneme;
+    int occurrences;
+    const std::vector<Entry>* partners;
+
+    Query(const char& phoneme, const int& occurrences, const std::vector<Entry>* partners) : phoneme(phoneme), occurrences(occurrences), partners(partners) {}
+  };
+
+private:
+  static constexpr char wildcard = '\0';
+
+  std::unordered_map<std::string, std::vector<Entry>> buckets;
+  std::vector<Query> queries; // For each syllable in the list, in order
+
+public:
+  Substitutions(const Syllables& syllables) {
+    Metrics::Timer timer("Substitutions::build");
+    SymbolTable& table = SymbolTable::pronunciations();
+    const size_t symbolCount = table.size();
+
+    // Every syllable with a count can be the result of a replacement
+    std::vector<size_t> positions;
+    for(size_t id = 0; id < symbolCount; ++id) {
+      const int freq = syllables.getSylFreq((int)id);
+      if(freq == 0) continue;
+
+      const std::string& syl = table.name((int)id);
+      std::string pattern = syl;
+      for(size_t i = 0; i < syl.length(); ++i) {
+        // Each phoneme is handled at its first position
+        if(syl.find(syl[i]) != i) continue;
+
+        positions.clear();
+        for(size_t j = i; j < syl.length(); ++j) {
+          if(syl[j] == syl[i]) positions.push_back(j);
+        }
+
+        // Any nonempty set of the positions can be the ones replaced
+        for(size_t subset = 1; subset < ((size_t)1 << positions.size()); ++subset) {
+          for(size_t j = 0; j < positions.size(); ++j) {
+            pattern[positions[j]] = (subset >> j & 1) ? wildcard : syl[i];
+          }
+          buckets[pattern].emplace_back(syl[i], freq);
+        }
+        for(const size_t& j : positions) {
+          pattern[j] = syl[i];
+        }
+      }
+    }
+
+    // Syllables in the list replace every occurrence of a phoneme at once.
+    // The buckets are only read from here, so large lists are split up.
+    queries = syllables.getData().reduce(std::vector<Query>(),
+      [&](std::vector<Query>& queries, const Syllables::Info& s) {
+        const std::string& syl = s.pronunciation();
+        std::string pattern = syl;
+        for(size_t i = 0; i < syl.length(); ++i) {
+          if(syl.find(syl[i]) != i) continue;
+
+          int occurrences = 0;
+          for(size_t j = i; j < syl.length(); ++j) {
+            if(syl[j] == syl[i]) {
+              pattern[j] = wildcard;
+              ++occurrences;
+            }
+          }
+
+          auto it = buckets.find(pattern);
+          if(it != buckets.end()) {
+            queries.emplace_back(syl[i], occurrences, &it->second);
+          }
+          pattern = syl;
+        }
+      },
+      [](std::vector<Query>& queries, const std::vector<Query>& other) {
+        queries.insert(queries.end(), other.begin(), other.end());
+      });
   }
+
+  Substitutions(const Substitutions& other) = delete;
+  Substitutions& operator=(const Substitutions& other) = delete;
+
+  const std::vector<Query>& getQueries() const { return queries; }
 };
 
 
@@ -232,6 +721,79 @@ public:
 private:
   std::string filePath;
   std::vector<std::vector<Info>> data;
+  std::string order; // Phonemes of the rows and columns
+  std::vector<int> pairCounts; // Before being made symmetric, so they can be updated
+
+  // Cache columns: the phonemes (0, 1) and the counts before being made symmetric (2)
+  static constexpr uint32_t cacheKind = 3;
+
+  // Fills data from pairCounts, made symmetric
+  void _fill() {
+    const size_t n = order.length();
+    std::vector<int> counts = pairCounts;
+
+    for(size_t i = 0; i < n; ++i) {
+      for(size_t j = i; j < n; ++j) {
+        counts[i * n + j] = (counts[i * n + j] + counts[j * n + i]) / 2;
+      }
+      for(size_t j = 0; j < i; ++j) {
+        counts[i * n + j] = counts[j * n + i];
+      }
+    }
+
+    data.clear();
+    for(size_t i = 0; i < n; ++i) {
+      std::vector<Info> v;
+      for(size_t j = 0; j < n; ++j) {
+        v.push_back(Info(order[i], order[j], counts[i * n + j]));
+      }
+      data.push_back(v);
+    }
+  }
+
+  void _writeCache() const {
+    Columnar::Writer writer(cacheKind, pairCounts.size());
+    writer.addStrings(std::vector<std::string_view>(1, order));
+    writer.addInts(pairCounts);
+    writer.write(Columnar::cachePath(filePath), filePath);
+  }
+
+  // Adds the counts up in counts, a vector or array holding a matrix of
+  // every pair of phonemes starting out as zeros, then fills data from it
+  template<typename Counts>
+  void _count(const Substitutions& substitutions, const PhonemeClassTable& phonemes, Counts counts) {
+    Metrics::Timer timer("Overlap::count");
+    const size_t n = phonemes.size();
+
+    clear();
+
+    // Large query lists are split up, each part adding into its own matrix
+    const std::vector<Substitutions::Query>& queries = substitutions.getQueries();
+    counts = Reduction::reduce(queries.size(), counts,
+      [&](Counts& counts, const size_t begin, const size_t end) {
+        for(size_t i = begin; i < end; ++i) {
+          const Substitutions::Query& q = queries[i];
+          const int a = phonemes.index(q.phoneme);
+          if(a < 0) continue;
+
+          for(const Substitutions::Entry& e : *q.partners) {
+            const int b = phonemes.index(e.phoneme);
+            if(b >= 0) {
+              counts[a * n + b] += q.occurrences * e.freqCount;
+            }
+          }
+        }
+      },
+      [](Counts& counts, const Counts& other) {
+        for(size_t i = 0; i < counts.size(); ++i) {
+          counts[i] += other[i];
+        }
+      }, ThreadPool::shared());
+
+    order = std::string(phonemes.phonemes());
+    pairCounts.assign(counts.begin(), counts.end());
+    _fill();
+  }
 
 public:
   Overlap() : filePath("Overlap.txt") {}
@@ -241,6 +803,8 @@ public:
 
   void clear() {
     data.clear();
+    order.clear();
+    pairCounts.clear();
   }
 
   std::string getPath() const { return filePath; }
@@ -250,48 +814,131 @@ public:
   const std::vector<std::vector<Info>>& getData() const { return data; }
   const Info& getInfoAt(const int& i, const int& j) const { return data.at(i).at(j); }
 
-  void count(const Syllables& syllables, const std::string& phonemes) {
-    std::unordered_map<char, int> phonemeNums;
+  void count(const Syllables& syllables, const PhonemeClassTable& phonemes) {
+    count(Substitutions(syllables), phonemes);
+  }
 
-    clear();
+  // For every syllable and phoneme a in it, adds the count of each syllable
+  // made by replacing every a with phoneme b to the pair (a, b), once per
+  // occurrence of a. The result is then made symmetric.
+  void count(const Substitutions& substitutions, const PhonemeClassTable& phonemes) {
+    _count(substitutions, phonemes, std::vector<int>(phonemes.size() * phonemes.size(), 0));
+  }
+  // Same as above for phonemes known at compile time
+  template<const PhonemeClassTable& Phonemes>
+  void count(const Substitutions& substitutions) {
+    _count(substitutions, Phonemes, std::array<int, Phonemes.size() * Phonemes.size()>());
+  }
 
-    int count = 0;
-    for(const char& c : phonemes) {
-      phonemeNums[c] = count;
-      ++count;
+  /* Updates counts made by count(), or read back with read(), for the
+     syllables that changed (see Syllables::applyDelta()), where syllables
+     holds the list after the changes. Only the terms of the sum that
+     involve a changed syllable are redone, one syllable at a time: the ones
+     where it has a phoneme replaced, and the ones where it is the result of
+     replacing every a in another syllable with one of its phonemes. */
+  void update(const std::vector<Syllables::Change>& changes, const Syllables& syllables) {
+    Metrics::Timer timer("Overlap::update");
+    SymbolTable& table = SymbolTable::pronunciations();
+    const PhonemeClassTable phonemes(order);
+    const size_t n = order.length();
+
+    // Counts of the syllables in the list as the changes are made, starting from before them
+    std::vector<int> freqs(table.size(), 0);
+    for(const Syllables::Info& i : syllables.getData()) {
+      freqs[i.id] = i.freqCount;
     }
-
-    for(const char& a : phonemes) {
-      std::vector<Info> v;
-      for(const char& b : phonemes) {
-        v.push_back(Info(a, b, 0));
-      }
-      data.push_back(v);
+    for(const Syllables::Change& c : changes) {
+      freqs[c.id] = c.before;
     }
+    auto freq = [&](const std::string& syl) {
+      const int id = table.find(syl);
+      return (id < 0 || (size_t)id >= freqs.size()) ? 0 : freqs[id];
+    };
+
+    // Adds sign times every term that involves syl, which must be in the list
+    std::string other;
+    std::vector<size_t> positions;
+    auto terms = [&](const std::string& syl, const int& sign) {
+      // syl with every a replaced by b, for each phoneme a in it
+      for(size_t i = 0; i < syl.length(); ++i) {
+        const int a = phonemes.index(syl[i]);
+        if(a < 0 || syl.find(syl[i]) != i) continue;
+
+        const int occurrences = std::count(syl.begin(), syl.end(), syl[i]);
+        for(size_t b = 0; b < n; ++b) {
+          other = syl;
+          std::replace(other.begin(), other.end(), syl[i], order[b]);
+          pairCounts[a * n + b] += sign * occurrences * freq(other);
+        }
+      }
 
-    const list<Syllables::Info>& sylList = syllables.getData();
-    for(const Syllables::Info& syl : sylList) {
-      for(const char& i : syl.pronunciation) {
-        if(StringFunctions::contains(phonemes, i)) {
-          for(const char& p : phonemes) {
-            std::string modifiedSyl = StringFunctions::replace(syl.pronunciation, i, p);
-            data.at(phonemeNums.at(i)).at(phonemeNums.at(p)).freqCount += syllables.getSylFreq(modifiedSyl);
+      // Syllables where replacing every a with b gives syl, for each phoneme
+      // b in it: syl with some of the positions of b holding an a that isn't
+      // anywhere else
+      const int sylFreq = freq(syl);
+      for(size_t i = 0; i < syl.length(); ++i) {
+        const int b = phonemes.index(syl[i]);
+        if(b < 0 || syl.find(syl[i]) != i) continue;
+
+        positions.clear();
+        for(size_t j = i; j < syl.length(); ++j) {
+          if(syl[j] == syl[i]) positions.push_back(j);
+        }
+
+        for(size_t subset = 1; subset < ((size_t)1 << positions.size()); ++subset) {
+          for(size_t a = 0; a < n; ++a) {
+            if(syl.find(order[a]) != std::string::npos) continue;
+
+            other = syl;
+            int occurrences = 0;
+            for(size_t j = 0; j < positions.size(); ++j) {
+              if(subset >> j & 1) {
+                other[positions[j]] = order[a];
+                ++occurrences;
+              }
+            }
+            if(freq(other) > 0) {
+              pairCounts[a * n + b] += sign * occurrences * sylFreq;
+            }
           }
         }
       }
-    }
+    };
 
-    for(int i = 0; i < data.size(); ++i) {
-      for(int j = i; j < data.size(); ++j) {
-        data.at(i).at(j).freqCount = (data.at(i).at(j).freqCount + data.at(j).at(i).freqCount) / 2;
+    for(const Syllables::Change& c : changes) {
+      const std::string& syl = table.name(c.id);
+      if(freqs[c.id] > 0) {
+        terms(syl, -1);
       }
-      for(int j = 0; j < i; ++j) {
-        data.at(i).at(j).freqCount = data.at(j).at(i).freqCount;
+      freqs[c.id] = c.after;
+      if(freqs[c.id] > 0) {
+        terms(syl, 1);
       }
     }
+
+    _fill();
   }
 
-  void write() const {
+  // Loads the counts from the cache write(true) leaves next to the file.
+  // The file itself only has them made symmetric, which can't be updated.
+  void read(const PhonemeClassTable& phonemes) {
+    Metrics::Timer timer("Overlap::read");
+    const size_t n = phonemes.size();
+    Columnar::Reader cache(Columnar::cachePath(filePath), cacheKind, filePath);
+    Columnar::Strings strings;
+    const int32_t* counts;
+    if(!cache.isValid() || !cache.strings(0, strings) || strings.size() != 1 || strings[0] != phonemes.phonemes() || !cache.ints(2, n * n, counts)) {
+      throw std::runtime_error("No up to date cache of the counts in " + filePath + ", they have to be counted again.");
+    }
+
+    order = std::string(phonemes.phonemes());
+    pairCounts.assign(counts, counts + n * n);
+    _fill();
+  }
+
+  // If cache is set, the counts are also written next to the file in a form read() can load and update
+  void write(const bool& cache = false) const {
+    Metrics::Timer timer("Overlap::write");
     std::ofstream file(filePath);
     if(file.is_open()) {
       file << "## This file was generated by code using data from another file." << std::endl;
@@ -312,10 +959,15 @@ public:
         file << line << std::endl;
       }
 
+      Metrics::shared().add("bytes written", (int64_t)file.tellp());
       file.close();
     } else {
       throw std::invalid_argument("File path not valid.");
     }
+
+    if(cache) {
+      _writeCache();
+    }
   }
 };
 
@@ -347,7 +999,21 @@ public:
 
 private:
   std::string filePath;
-  list<Info> data;
+  list<Info, poolAllocator> data;
+
+  // Length of the run of consonants that starts pron
+  static size_t _split(std::string_view pron, const PhonemeClassTable& consonants) {
+    size_t split = 0;
+    while(split < pron.length() && consonants.contains(pron[split])) {
+      ++split;
+    }
+    return split;
+  }
+
+  void _add(const char& c, const int& start, const int& end) {
+    float percent = (float)start / (float)(start + end);
+    data.emplace_back(c, start, end, percent);
+  }
 
 public:
   Positional() : filePath("Positional.txt") {}
@@ -363,55 +1029,76 @@ public:
   void setPath(const std::string& path) { filePath = path; }
 
   int size() const { return data.size(); }
-  const list<Info>& getData() const { return data; }
+  const list<Info, poolAllocator>& getData() const { return data; }
   const Info& getInfoAt(const int& i) const { return data.at(i); }
+  // For callers that look records up by position, which then takes O(log n)
+  void setIndexed(const bool& enable) { data.setIndexed(enable); }
 
-  void count(const Syllables& syllables, const std::string& consonants) {
-    std::unordered_map<char, int> startCounts;
-    std::unordered_map<char, int> endCounts;
+  // Consonants before the first other phoneme of a syllable count as
+  // starting it, the rest as ending it
+  void count(const Syllables& syllables, const PhonemeClassTable& consonants) {
+    Metrics::Timer timer("Positional::count");
+    typedef std::pair<Histogram, Histogram> Counts; // Starting and ending
 
     clear();
 
-    for(const char& c : consonants) {
-      startCounts.insert(std::make_pair(c, 0));
-      endCounts.insert(std::make_pair(c, 0));
+    const Counts counts = syllables.getData().reduce(Counts(),
+      [&](Counts& counts, const Syllables::Info& syl) {
+        std::string_view pron = syl.pronunciation();
+        const size_t split = _split(pron, consonants);
+
+        // Everything is counted, but only the consonants are read back
+        counts.first.add(pron.substr(0, split), syl.freqCount);
+        counts.second.add(pron.substr(split), syl.freqCount);
+      },
+      [](Counts& counts, const Counts& other) {
+        counts.first.merge(other.first);
+        counts.second.merge(other.second);
+      });
+
+    for(const char& c : consonants.phonemes()) {
+      _add(c, (int)counts.first.total(c), (int)counts.second.total(c));
     }
+  }
 
-    const list<Syllables::Info>& sylList = syllables.getData();
-    for(const Syllables::Info& syl : sylList) {
-      bool vowel = false;
-      for(const char& i : syl.pronunciation) {
-        if(StringFunctions::contains(consonants, i)) {
-          if(!vowel) {
-            startCounts.at(i) += syl.freqCount;
-          } else {
-            endCounts.at(i) += syl.freqCount;
-          }
-        } else {
-          vowel = true;
-        }
+  // Updates counts made by count(), or read back from the files, for the
+  // syllables that changed (see Syllables::applyDelta())
+  void update(const std::vector<Syllables::Change>& changes, const PhonemeClassTable& consonants) {
+    Metrics::Timer timer("Positional::update");
+    long long startCounts[256] = {};
+    long long endCounts[256] = {};
+    for(const Info& i : data) {
+      startCounts[(unsigned char)i.sound] += i.startFreq;
+      endCounts[(unsigned char)i.sound] += i.endFreq;
+    }
+
+    for(const Syllables::Change& c : changes) {
+      std::string_view pron = SymbolTable::pronunciations().name(c.id);
+      const size_t split = _split(pron, consonants);
+      for(size_t i = 0; i < pron.length(); ++i) {
+        long long* counts = i < split ? startCounts : endCounts;
+        counts[(unsigned char)pron[i]] += (long long)c.after - c.before;
       }
     }
 
-    for(const char& c : consonants) {
-      int start = startCounts.at(c);
-      int end = endCounts.at(c);
-      float percent = (float)start / (float)(start + end);
-      data.add(Info(c, start, end, percent));
+    clear();
+    for(const char& c : consonants.phonemes()) {
+      _add(c, (int)startCounts[(unsigned char)c], (int)endCounts[(unsigned char)c]);
     }
   }
 
   void sortByStart() {
-    auto compare = [&](const Info& a, const Info& b) { return a.startFreq > b.startFreq; };
-    data.sort(compare);
+    Metrics::Timer timer("Positional::sort");
+    data.sortByKey([](const Info& i) { return i.startFreq; }, true);
   }
 
   void sortByEnd() {
-    auto compare = [&](const Info& a, const Info& b) { return a.endFreq > b.endFreq; };
-    data.sort(compare);
+    Metrics::Timer timer("Positional::sort");
+    data.sortByKey([](const Info& i) { return i.endFreq; }, true);
   }
 
   void write() const {
+    Metrics::Timer timer("Positional::write");
     std::ofstream file(filePath);
     if(file.is_open()) {
       file << "## This file was generated by code using data from another file." << std::endl;
@@ -425,13 +1112,52 @@ public:
         file << line << std::endl;
       }
 
+      Metrics::shared().add("bytes written", (int64_t)file.tellp());
       file.close();
     } else {
       throw std::invalid_argument("File path not valid.");
     }
   }
 
+  // Reads the counts written by write(start, end) into the phonemes already
+  // there, adding the ones that aren't. Read the starting and ending counts
+  // from their files one after the other to get back what count() made.
+  void read(const bool& start, const bool& end) {
+    Metrics::Timer timer("Positional::read");
+    MappedFile file(filePath);
+    if(!file.isOpen()) {
+      throw std::invalid_argument("File path not valid.");
+    }
+
+    Metrics::shared().add("bytes read", file.size());
+    RecordReader reader(file.view());
+    reader.setDelimiter(deliminator);
+    std::vector<std::string_view> segments;
+    const size_t segmentCount = 1 + start + end + (start || end);
+    while(reader.next(segments, segmentCount)) {
+      const char sound = segments[0].at(0);
+      Info* info = nullptr;
+      for(Info& i : data) {
+        if(i.sound == sound) {
+          info = &i;
+        }
+      }
+      if(info == nullptr) {
+        info = &data.emplace_back(sound, 0, 0, 0.0f);
+      }
+
+      if(start) {
+        info->startFreq = StringFunctions::toInteger(segments[1]);
+      }
+      if(end) {
+        info->endFreq = StringFunctions::toInteger(segments[start ? 2 : 1]);
+      }
+      info->percentStart = (float)info->startFreq / (float)(info->startFreq + info->endFreq);
+    }
+  }
+
   void write(const bool& start, const bool& end) const {
+    Metrics::Timer timer("Positional::write");
     std::ofstream file(filePath);
     if(file.is_open()) {
       file << "## This file was generated by code using data from another file." << std::endl;
@@ -457,6 +1183,7 @@ public:
         file << line << std::endl;
       }
 
+      Metrics::shared().add("bytes written", (int64_t)file.tellp());
       file.close();
     } else {
       throw std::invalid_argument("File path not valid.");
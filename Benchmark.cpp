@@ -0,0 +1,362 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+
+#include "LinkedList.hpp"
+#include "StringFunctions.hpp"
+#include "Analysis.cpp"
+#include "CelexAlphabet.hpp"
+
+
+/* Times list<T>, StringFunctions, the parsers and the analyses at several
+   input sizes, without any benchmark library. Build it like main.cpp:
+
+     g++ -std=c++17 -O2 -fpermissive Benchmark.cpp -o benchmark
+     ./benchmark [filter] [repetitions]
+
+   Only cases whose name contains filter are run. Each case is run the
+   given number of times (5 by default) and the median is reported, as
+   nanoseconds per item and items per second. The parsers and analyses
+   read the first records of data/CelexCountSylPron.txt, or of
+   data/CuratedPronunciation.txt if the source isn't there. */
+class Benchmark {
+private:
+  std::string filter;
+  int repetitions;
+
+  // Runs that are too short to time well are repeated until they take this long
+  static constexpr int64_t minimumRun = 1000000; // In nanoseconds
+
+  static int64_t _now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void _report(const std::string& name, const size_t& size, const size_t& items, std::vector<double>& times) const {
+    std::sort(times.begin(), times.end());
+    const double time = times[times.size() / 2]; // Nanoseconds per run
+    const double perItem = time / (items > 0 ? items : 1);
+
+    std::cout << std::left << std::setw(36) << name
+              << std::right << std::setw(10) << size
+              << std::fixed << std::setprecision(2) << std::setw(14) << perItem << " ns/item"
+              << std::setprecision(0) << std::setw(16) << 1e9 / perItem << " items/s" << std::endl;
+  }
+
+public:
+  // Results are added in here, so the compiler can't leave out the work
+  inline static volatile uint64_t sink = 0;
+
+  Benchmark(const std::string& filter, const int& repetitions) : filter(filter), repetitions(repetitions) {}
+
+  bool selected(const std::string& name) const {
+    return name.find(filter) != std::string::npos;
+  }
+
+  /* Times body, which handles items things on input of the given size and
+     leaves everything the way it found it, so it can be run repeatedly. */
+  template<typename Body>
+  void run(const std::string& name, const size_t& size, const size_t& items, Body body) const {
+    if(!selected(name)) return;
+
+    std::vector<double> times;
+    for(int r = 0; r < repetitions; ++r) {
+      size_t runs = 0;
+      const int64_t start = _now();
+      int64_t elapsed;
+      do {
+        sink += (uint64_t)body();
+        ++runs;
+        elapsed = _now() - start;
+      } while(elapsed < minimumRun);
+      times.push_back((double)elapsed / runs);
+    }
+    _report(name, size, items, times);
+  }
+
+  /* Times body once per repetition, after setup gets its input ready. For
+     work that changes its input, like sorting. */
+  template<typename Setup, typename Body>
+  void run(const std::string& name, const size_t& size, const size_t& items, Setup setup, Body body) const {
+    if(!selected(name)) return;
+
+    std::vector<double> times;
+    for(int r = 0; r < repetitions; ++r) {
+      setup();
+      const int64_t start = _now();
+      sink += (uint64_t)body();
+      times.push_back((double)(_now() - start));
+    }
+    _report(name, size, items, times);
+  }
+};
+
+
+void benchmarkList(const Benchmark& bench) {
+  for(const size_t n : {1000, 10000, 100000}) {
+    std::mt19937 random(1);
+    std::vector<int> values(n);
+    for(int& v : values) {
+      v = (int)random();
+    }
+
+    list<int> l;
+    bench.run("list<int>::add", n, n, [&]() { l.clear(); }, [&]() {
+      for(const int& v : values) {
+        l.add(v);
+      }
+      return l.size();
+    });
+
+    // At random positions, found through the index
+    const size_t inserts = n / 10;
+    bench.run("list<int>::insert", n, inserts, [&]() {
+      l.clear();
+      l.setIndexed(true);
+      for(const int& v : values) {
+        l.add(v);
+      }
+    }, [&]() {
+      for(size_t i = 0; i < inserts; ++i) {
+        l.insert(values[i] % l.size(), values[i]);
+      }
+      return l.size();
+    });
+    l.setIndexed(false);
+
+    // Every other value, while walking the list
+    bench.run("list<int>::remove", n, n / 2, [&]() {
+      l.clear();
+      for(const int& v : values) {
+        l.add(v);
+      }
+    }, [&]() {
+      bool odd = false;
+      for(list<int>::iterator i = l.begin(); i != l.end();) {
+        if(odd) {
+          l.remove(i);
+        } else {
+          ++i;
+        }
+        odd = !odd;
+      }
+      return l.size();
+    });
+
+    bench.run("list<int>::sort", n, n, [&]() {
+      l.clear();
+      for(const int& v : values) {
+        l.add(v);
+      }
+    }, [&]() {
+      l.sort();
+      return l.back();
+    });
+
+    l.clear();
+    for(const int& v : values) {
+      l.add(v);
+    }
+    bench.run("list<int>::reverse", n, n, [&]() {
+      l.reverse();
+      return l.back();
+    });
+
+    bench.run("list<int> iteration", n, n, [&]() {
+      int64_t sum = 0;
+      for(const int& v : l) {
+        sum += v;
+      }
+      return sum;
+    });
+  }
+}
+
+
+void benchmarkStringFunctions(const Benchmark& bench) {
+  for(const size_t n : {16, 1000, 100000}) {
+    // Lowercase words with dashes between them, like a syllable list
+    std::mt19937 random(2);
+    std::string text;
+    while(text.length() < n) {
+      text += (random() % 6 == 0) ? '-' : (char)('a' + random() % 26);
+    }
+    std::string letters = StringFunctions::remove(text, '-');
+    letters.resize(n, 'a');
+    const std::string same(n, 'a');
+    const std::string dashes = "--";
+    std::vector<std::string> parts = StringFunctions::split(text, '-');
+    std::vector<std::string_view> views;
+
+    // Numbers, counted per number instead of per character
+    std::vector<std::string> numbers;
+    for(size_t i = 0; i < n / 8 + 1; ++i) {
+      numbers.push_back(std::to_string((int)(random() % 2000000) - 1000000));
+    }
+
+    bench.run("StringFunctions::contains", n, n, [&]() { return StringFunctions::contains(text, '#'); });
+    bench.run("StringFunctions::onlyContains", n, n, [&]() { return StringFunctions::onlyContains(same, 'a'); });
+    bench.run("StringFunctions::onlyAlphabetical", n, n, [&]() { return StringFunctions::onlyAlphabetical(letters); });
+    bench.run("StringFunctions::isLowercase", n, n, [&]() { return StringFunctions::isLowercase(text); });
+    bench.run("StringFunctions::remove", n, n, [&]() { return StringFunctions::remove(text, '-').length(); });
+    bench.run("StringFunctions::replace(char)", n, n, [&]() { return StringFunctions::replace(text, '-', '.').length(); });
+    bench.run("StringFunctions::replace(string)", n, n, [&]() { return StringFunctions::replace(text, '-', dashes).length(); });
+    bench.run("StringFunctions::tolower", n, n, [&]() { return StringFunctions::tolower(text).length(); });
+    bench.run("StringFunctions::splitView", n, n, [&]() {
+      StringFunctions::splitView(text, '-', views);
+      return views.size();
+    });
+    bench.run("StringFunctions::split", n, n, [&]() { return StringFunctions::split(text, '-').size(); });
+    bench.run("StringFunctions::toString", n, n, [&]() { return StringFunctions::toString(parts, '-').length(); });
+    bench.run("StringFunctions::isInteger", n, numbers.size(), [&]() {
+      size_t result = 0;
+      for(const std::string& number : numbers) {
+        result += StringFunctions::isInteger(number);
+      }
+      return result;
+    });
+    bench.run("StringFunctions::toInteger", n, numbers.size(), [&]() {
+      int64_t result = 0;
+      for(const std::string& number : numbers) {
+        result += StringFunctions::toInteger(number);
+      }
+      return result;
+    });
+  }
+}
+
+
+// Copies the header and the first records of source to a file of its own,
+// and returns its path
+std::string sample(const std::string& source, const size_t& records) {
+  const std::string path = (std::filesystem::temp_directory_path() / ("WordFrequencyBenchmark" + std::to_string(records) + ".txt")).string();
+
+  std::ifstream in(source);
+  std::ofstream out(path, std::ios::trunc);
+  std::string line;
+  bool header = false;
+  size_t count = 0;
+  while(count < records && std::getline(in, line)) {
+    out << line << '\n';
+    if(line.empty() || line.rfind("##", 0) == 0) continue;
+    if(!header) {
+      header = true;
+    } else {
+      ++count;
+    }
+  }
+  return path;
+}
+
+
+void benchmarkParsers(const Benchmark& bench) {
+  std::string source = "data/CelexCountSylPron.txt";
+  if(!std::filesystem::exists(source)) {
+    source = "data/CuratedPronunciation.txt";
+  }
+  if(!std::filesystem::exists(source)) {
+    std::cout << "No source data, skipping the parsers and analyses" << std::endl;
+    return;
+  }
+
+  for(const size_t n : {1000, 10000, 100000}) {
+    const std::string path = sample(source, n);
+    Words words(path);
+    words.read();
+    const size_t records = words.size();
+
+    bench.run("Words::read", records, records, [&]() { words.clear(); }, [&]() {
+      words.read();
+      return words.size();
+    });
+
+    bench.run("Words::eliminate", records, records, [&]() {
+      words.clear();
+      words.read();
+    }, [&]() {
+      words.eliminate();
+      return words.size();
+    });
+
+    // The later cases start from these, whichever of the cases before them run
+    auto eliminated = [&]() {
+      words.clear();
+      words.read();
+      words.eliminate();
+    };
+    eliminated();
+    const size_t kept = words.size();
+
+    bench.run("Words::replacePron", kept, kept, eliminated, [&]() {
+      words.replacePron(celex);
+      return words.size();
+    });
+    eliminated();
+    words.replacePron(celex);
+
+    Syllables syllables;
+    bench.run("Syllables::import", kept, kept, [&]() {
+      syllables.import(words);
+      return syllables.size();
+    });
+    syllables.import(words);
+    syllables.eliminate(vowels);
+    syllables.sort();
+    const size_t sylCount = syllables.size();
+
+    bench.run("Phonemes::count", sylCount, sylCount, [&]() {
+      Phonemes phonemes;
+      phonemes.count(syllables);
+      return phonemes.size();
+    });
+    bench.run("Blends::count", sylCount, sylCount, [&]() {
+      Blends blends;
+      blends.count(syllables, consonants);
+      return blends.size();
+    });
+    bench.run("Positional::count", sylCount, sylCount, [&]() {
+      Positional positional;
+      positional.count(syllables, consonants);
+      return positional.size();
+    });
+    bench.run("Substitutions", sylCount, sylCount, [&]() {
+      Substitutions substitutions(syllables);
+      return substitutions.getQueries().size();
+    });
+    bench.run("Overlap::count (vowels)", sylCount, sylCount, [&]() {
+      Overlap overlap;
+      overlap.count(syllables, vowels);
+      return overlap.size();
+    });
+    bench.run("Overlap::count (consonants)", sylCount, sylCount, [&]() {
+      Overlap overlap;
+      overlap.count(syllables, consonants);
+      return overlap.size();
+    });
+
+    std::filesystem::remove(path);
+    if(records < n) break; // The whole file has been used
+  }
+}
+
+
+int main(int argc, char** argv) {
+  const std::string filter = argc > 1 ? argv[1] : "";
+  const int repetitions = argc > 2 ? std::max(1, std::stoi(argv[2])) : 5;
+  Benchmark bench(filter, repetitions);
+
+  std::cout << std::left << std::setw(36) << "Case" << std::right << std::setw(10) << "Size" << std::setw(23) << "Time" << std::setw(24) << "Rate" << std::endl;
+  benchmarkList(bench);
+  benchmarkStringFunctions(bench);
+  benchmarkParsers(bench);
+
+  return 0;
+}
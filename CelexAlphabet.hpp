@@ -0,0 +1,34 @@
+#pragma once
+
+#include "PhonemeClassTable.hpp"
+#include "PhonemeAlphabet.hpp"
+
+
+// The phonemes the analyses work on, and how the CELEX phonemes map onto them
+constexpr PhonemeClassTable vowels = {
+  '@', 'I', '{', 'E', 'V',
+  'i', 'u', 'Q', '2', '1',
+  '5', '3', '#', '$', '6',
+  '8', '7', '4' };
+constexpr PhonemeClassTable consonants = {
+  't', 'n', 'r', 's', 'd',
+  'l', 'k', 'D', 'z', 'm',
+  'h', 'v', 'w', 'p', 'Y',
+  'b', 'f', 'S', 'g', 'J',
+  '_' };
+constexpr PhonemeAlphabet celex(vowels, consonants, {
+  PhonemeRule('R', "r"),
+  PhonemeRule('9', "u"),
+  PhonemeRule('H', "@n"),
+  PhonemeRule('P', "@l"),
+  PhonemeRule('~', "Q"),
+  PhonemeRule('q', "Q"),
+  PhonemeRule('x', "g"),
+  PhonemeRule('c', "I"),
+  PhonemeRule('0', "Q"),
+  PhonemeRule('F', "m"),
+  PhonemeRule('T', "D"),
+  PhonemeRule('Z', "zh"),
+  PhonemeRule('j', "Y"),
+  PhonemeRule('N', "Y"),
+  PhonemeRule('U', "@") });
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+#include "MappedFile.hpp"
+#include "Metrics.hpp"
+
+
+/* Binary cache of a data file, laid out column by column so it can be used
+   straight from a memory mapping. A column is an array of 32-bit integers or
+   of characters, and a list of strings is stored as an offsets column plus
+   a characters column. The header records the size and modification time of
+   the text file the cache was made from, and a cache that doesn't match it
+   is ignored. Numbers are stored in the byte order of the machine that wrote
+   them, so caches shouldn't be copied between machines. */
+namespace Columnar {
+  constexpr char magic[4] = {'W', 'F', 'A', 'C'};
+  // Bump whenever the layout of any kind of cache changes
+  constexpr uint32_t version = 3;
+
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t kind;
+    uint32_t columnCount;
+    uint64_t records;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+  };
+
+  struct Column {
+    uint64_t offset;
+    uint64_t size; // In bytes
+  };
+
+  std::string cachePath(const std::string& path) {
+    return path + ".bin";
+  }
+
+  /* Gets the size and modification time of a file. Returns false if it doesn't exist. */
+  bool stamp(const std::string& path, uint64_t& size, int64_t& time) {
+    std::error_code error;
+    size = std::filesystem::file_size(path, error);
+    if(error) return false;
+    time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    return !error;
+  }
+
+  /* List of strings stored in a cache. The views point into the mapping. */
+  class Strings {
+  private:
+    const int32_t* offsets;
+    const char* chars;
+    size_t count;
+
+  public:
+    Strings() : offsets(nullptr), chars(nullptr), count(0) {}
+    Strings(const int32_t* offsets, const char* chars, const size_t& count) : offsets(offsets), chars(chars), count(count) {}
+
+    size_t size() const { return count; }
+    std::string_view operator[](const size_t i) const {
+      return std::string_view(chars + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+  };
+
+
+  class Writer {
+  private:
+    uint32_t kind;
+    uint64_t records;
+    std::vector<std::string> columns;
+
+  public:
+    Writer(const uint32_t& kind, const uint64_t& records) : kind(kind), records(records) {}
+
+    // Returns the number of the new column
+    size_t addInts(const std::vector<int32_t>& values) {
+      columns.emplace_back((const char*)values.data(), values.size() * sizeof(int32_t));
+      return columns.size() - 1;
+    }
+
+    // Adds an offsets column and a characters column. Returns the number of the offsets column.
+    size_t addStrings(const std::vector<std::string_view>& strings) {
+      std::vector<int32_t> offsets;
+      offsets.reserve(strings.size() + 1);
+      std::string chars;
+
+      offsets.push_back(0);
+      for(const std::string_view& s : strings) {
+        chars += s;
+        offsets.push_back((int32_t)chars.length());
+      }
+
+      const size_t column = addInts(offsets);
+      columns.push_back(std::move(chars));
+      return column;
+    }
+
+    // Writes the cache for the text file at sourcePath. The file is written
+    // under a temporary name first, so readers never see half of it.
+    bool write(const std::string& path, const std::string& sourcePath) const {
+      Header header = {};
+      std::copy(magic, magic + 4, header.magic);
+      header.version = version;
+      header.kind = kind;
+      header.columnCount = (uint32_t)columns.size();
+      header.records = records;
+      if(!stamp(sourcePath, header.sourceSize, header.sourceTime)) return false;
+
+      // Every column starts on an 8 byte boundary
+      std::vector<Column> table(columns.size());
+      uint64_t offset = sizeof(Header) + columns.size() * sizeof(Column);
+      for(size_t i = 0; i < columns.size(); ++i) {
+        offset = (offset + 7) & ~(uint64_t)7;
+        table[i].offset = offset;
+        table[i].size = columns[i].size();
+        offset += columns[i].size();
+      }
+
+      const std::string tempPath = path + ".tmp";
+      {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if(!file.is_open()) return false;
+
+        file.write((const char*)&header, sizeof(Header));
+        file.write((const char*)table.data(), table.size() * sizeof(Column));
+        uint64_t written = sizeof(Header) + table.size() * sizeof(Column);
+        for(size_t i = 0; i < columns.size(); ++i) {
+          static const char padding[8] = {};
+          file.write(padding, table[i].offset - written);
+          file.write(columns[i].data(), columns[i].size());
+          written = table[i].offset + columns[i].size();
+        }
+        if(!file) return false;
+      }
+
+      std::error_code error;
+      std::filesystem::rename(tempPath, path, error);
+      if(error) return false;
+      Metrics::shared().add("bytes written", offset);
+      return true;
+    }
+  };
+
+
+  class Reader {
+  private:
+    MappedFile file;
+    const Header* header;
+    const Column* table;
+
+    const char* _column(const size_t column, const size_t elementSize, size_t& count) const {
+      if(header == nullptr || column >= header->columnCount) return nullptr;
+      if(table[column].size % elementSize != 0) return nullptr;
+      count = table[column].size / elementSize;
+      return file.view().data() + table[column].offset;
+    }
+
+  public:
+    // The cache is only valid if it is of the given kind and was made from
+    // the current version of the file at sourcePath, or if that file is gone
+    Reader(const std::string& path, const uint32_t& kind, const std::string& sourcePath) : file(path), header(nullptr), table(nullptr) {
+      const std::string_view data = file.view();
+      if(!file.isOpen() || data.length() < sizeof(Header)) return;
+
+      const Header* h = (const Header*)data.data();
+      if(!std::equal(magic, magic + 4, h->magic) || h->version != version || h->kind != kind) return;
+      if(data.length() < sizeof(Header) + (uint64_t)h->columnCount * sizeof(Column)) return;
+
+      uint64_t size;
+      int64_t time;
+      if(stamp(sourcePath, size, time) && (size != h->sourceSize || time != h->sourceTime)) return;
+
+      const Column* t = (const Column*)(data.data() + sizeof(Header));
+      for(uint32_t i = 0; i < h->columnCount; ++i) {
+        if(t[i].offset % 8 != 0 || t[i].offset > data.length() || t[i].size > data.length() - t[i].offset) return;
+      }
+
+      header = h;
+      table = t;
+      Metrics::shared().add("bytes read", data.length());
+    }
+
+    bool isValid() const { return header != nullptr; }
+    size_t records() const { return header->records; }
+
+    // Gets an integer column that must hold count values
+    bool ints(const size_t column, const size_t count, const int32_t*& result) const {
+      size_t found;
+      result = (const int32_t*)_column(column, sizeof(int32_t), found);
+      return result != nullptr && found == count;
+    }
+
+    // Gets count lists of integers stored as an offsets column followed by a
+    // values column, where every value must be below limit
+    bool lists(const size_t column, const size_t count, const size_t limit, const int32_t*& offsets, const int32_t*& values) const {
+      size_t valueCount;
+      if(!ints(column, count + 1, offsets)) return false;
+      values = (const int32_t*)_column(column + 1, sizeof(int32_t), valueCount);
+      if(values == nullptr || offsets[0] != 0) return false;
+
+      for(size_t i = 1; i <= count; ++i) {
+        if(offsets[i] < offsets[i - 1]) return false;
+      }
+      if((size_t)offsets[count] != valueCount) return false;
+
+      for(size_t i = 0; i < valueCount; ++i) {
+        if(values[i] < 0 || (size_t)values[i] >= limit) return false;
+      }
+      return true;
+    }
+
+    // Gets the strings stored starting at the given offsets column
+    bool strings(const size_t column, Strings& result) const {
+      size_t offsetCount;
+      size_t charCount;
+      const int32_t* offsets = (const int32_t*)_column(column, sizeof(int32_t), offsetCount);
+      const char* chars = _column(column + 1, 1, charCount);
+      if(offsets == nullptr || chars == nullptr || offsetCount == 0 || offsets[0] != 0) return false;
+
+      for(size_t i = 1; i < offsetCount; ++i) {
+        if(offsets[i] < offsets[i - 1]) return false;
+      }
+      if((size_t)offsets[offsetCount - 1] > charCount) return false;
+
+      result = Strings(offsets, chars, offsetCount - 1);
+      return true;
+    }
+  };
+}
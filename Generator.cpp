@@ -0,0 +1,347 @@
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <stdexcept>
+
+#include "MappedFile.hpp"
+#include "Parser.cpp"
+#include "CelexAlphabet.hpp"
+
+
+/* Writes a made up corpus in the format of CelexCountSylPron.txt, of any
+   size, for testing at scales the real data can't reach. Build it like
+   main.cpp:
+
+     g++ -std=c++17 -O2 -fpermissive Generator.cpp -o generator
+     ./generator <path> <records> [--option value]...
+
+   Words are strings of syllables drawn by how common they are in
+   data/SyllableCounts.txt, with as many syllables as CELEX words tend to
+   have. A few syllables are new ones, built from phonemes drawn by how
+   common they are in data/PhonemeCounts.txt. Words are spelled with a
+   letter or two per phoneme. Their counts follow Zipf's law: a record at
+   rank r of the corpus gets top / r^zipf, rounded down but at least 1, so
+   only the records --zeros asks for have a count of 0.
+
+   The rest of the options set how often a record tests a path of
+   Words::eliminate() or of the replacements:
+     --zeros       the record has a count of 0
+     --duplicates  another variation of the word follows it
+     --uppercase   the word starts with a capital
+     --nonalpha    the word has an apostrophe, hyphen or space in it
+     --quotes      a syllable is stressed with a quotation mark
+     --celex       a syllable uses the CELEX phoneme a rule replaces
+     --novel       a syllable is a new one
+   and --seed, --zipf, --top, --syllables and --phonemes set the rest. */
+class Generator {
+public:
+  class Options {
+  public:
+    uint64_t seed = 1;
+    double zipf = 1.0;
+    double top = 1000000.0; // Count of the most common word
+    double zeros = 0.01;
+    double duplicates = 0.1;
+    double uppercase = 0.05;
+    double nonalpha = 0.02;
+    double quotes = 0.05;
+    double celex = 0.05;
+    double novel = 0.01;
+    std::string syllables = "data/SyllableCounts.txt";
+    std::string phonemes = "data/PhonemeCounts.txt";
+  };
+
+private:
+  // How many CELEX words have 1 to 8 syllables
+  static constexpr double syllableCountWeights[8] = {16877, 31127, 19676, 8887, 3106, 526, 74, 10};
+  static constexpr int maxVariations = 4; // Of the same word in a row
+
+  Options options;
+  std::mt19937_64 random;
+  std::uniform_real_distribution<double> chance;
+
+  std::vector<std::string> syllables;
+  std::vector<std::string> spellings; // Of each syllable
+  std::discrete_distribution<int> pickSyllable;
+  std::discrete_distribution<int> pickLength;
+
+  std::string vowels;
+  std::string consonants;
+  std::discrete_distribution<int> pickVowel;
+  std::discrete_distribution<int> pickConsonant;
+
+  // What the replacement rules turn each CELEX phoneme into, for the ones they change
+  std::vector<std::pair<std::string, char>> rules;
+
+  // Spelling of each phoneme of the alphabet
+  static std::string_view _spelling(const char& c) {
+    switch(c) {
+      case '@': return "a";   case 'I': return "i";   case '{': return "a";
+      case 'E': return "e";   case 'V': return "u";   case 'i': return "ee";
+      case 'u': return "oo";  case 'Q': return "o";   case '2': return "i";
+      case '1': return "ai";  case '5': return "o";   case '3': return "er";
+      case '#': return "ar";  case '$': return "or";  case '6': return "ou";
+      case '8': return "ere"; case '7': return "ear"; case '4': return "oi";
+      case 'k': return "c";   case 'D': return "th";  case 'Y': return "y";
+      case 'S': return "sh";  case 'J': return "ch";  case '_': return "j";
+    }
+    if(std::isalpha((unsigned char)c)) {
+      static const std::string letters = "abcdefghijklmnopqrstuvwxyz";
+      return std::string_view(letters).substr(std::tolower((unsigned char)c) - 'a', 1);
+    }
+    return "";
+  }
+
+  static std::string _spell(std::string_view syllable) {
+    std::string result;
+    for(const char& c : syllable) {
+      result += _spelling(c);
+    }
+    return result;
+  }
+
+  // Reads a file of Name<delim>Count records
+  static void _readCounts(const std::string& path, const char& delim, std::vector<std::string>& names, std::vector<double>& counts) {
+    MappedFile file(path);
+    if(!file.isOpen()) throw std::runtime_error("Could not open file " + path + ".");
+
+    RecordReader reader(file.view());
+    reader.setDelimiter(delim);
+    std::vector<std::string_view> segments;
+    while(reader.next(segments, 2)) {
+      names.emplace_back(segments[0]);
+      counts.push_back(StringFunctions::toInteger(segments[1]));
+    }
+  }
+
+  bool _happens(const double& rate) {
+    return chance(random) < rate;
+  }
+
+  // A syllable of up to two consonants, a vowel and up to two more consonants
+  std::string _novelSyllable() {
+    std::string result;
+    const int onset = (int)(random() % 3);
+    const int coda = (int)(random() % 3);
+    for(int i = 0; i < onset; ++i) {
+      result += consonants[pickConsonant(random)];
+    }
+    result += vowels[pickVowel(random)];
+    for(int i = 0; i < coda; ++i) {
+      result += consonants[pickConsonant(random)];
+    }
+    return result;
+  }
+
+  // Adds the syllable, with its spelling to spelling
+  void _syllable(std::string& pronunciation, std::string& spelling) {
+    std::string syl;
+    if(_happens(options.novel)) {
+      syl = _novelSyllable();
+      spelling += _spell(syl);
+    } else {
+      const int i = pickSyllable(random);
+      syl = syllables[i];
+      spelling += spellings[i];
+    }
+
+    if(_happens(options.celex)) {
+      // Undoes one rule that applies, as if the syllable came from CELEX
+      std::vector<size_t> found;
+      for(size_t r = 0; r < rules.size(); ++r) {
+        if(syl.find(rules[r].first) != std::string::npos) found.push_back(r);
+      }
+      if(!found.empty()) {
+        const std::pair<std::string, char>& rule = rules[found[random() % found.size()]];
+        syl.replace(syl.find(rule.first), rule.first.length(), 1, rule.second);
+      }
+    }
+    if(_happens(options.quotes)) {
+      pronunciation += '"';
+    }
+    pronunciation += syl;
+  }
+
+public:
+  Generator(const Options& options) : options(options), random(options.seed), chance(0.0, 1.0) {
+    std::vector<double> counts;
+    _readCounts(options.syllables, '\\', syllables, counts);
+    if(syllables.empty()) throw std::runtime_error("No syllables in " + options.syllables + ".");
+    pickSyllable = std::discrete_distribution<int>(counts.begin(), counts.end());
+    for(const std::string& syl : syllables) {
+      spellings.push_back(_spell(syl));
+    }
+    pickLength = std::discrete_distribution<int>(std::begin(syllableCountWeights), std::end(syllableCountWeights));
+
+    // Phonemes are split by the alphabet, so a new syllable always has a vowel
+    std::vector<std::string> phonemes;
+    std::vector<double> phonemeCounts;
+    _readCounts(options.phonemes, ',', phonemes, phonemeCounts);
+    std::vector<double> vowelCounts;
+    std::vector<double> consonantCounts;
+    for(size_t i = 0; i < phonemes.size(); ++i) {
+      if(phonemes[i].length() != 1) continue;
+      if(celex.vowels.contains(phonemes[i][0])) {
+        vowels += phonemes[i][0];
+        vowelCounts.push_back(phonemeCounts[i]);
+      } else if(celex.consonants.contains(phonemes[i][0])) {
+        consonants += phonemes[i][0];
+        consonantCounts.push_back(phonemeCounts[i]);
+      }
+    }
+    if(vowels.empty() || consonants.empty()) throw std::runtime_error("No vowels or consonants in " + options.phonemes + ".");
+    pickVowel = std::discrete_distribution<int>(vowelCounts.begin(), vowelCounts.end());
+    pickConsonant = std::discrete_distribution<int>(consonantCounts.begin(), consonantCounts.end());
+
+    for(size_t c = 0; c < 256; ++c) {
+      const std::string_view image = celex.replacement((char)c);
+      if(image.length() == 1 && image[0] == (char)c) continue;
+      if(image.empty() || c == '-' || c == '\\' || c == '"') continue;
+      rules.emplace_back(std::string(image), (char)c);
+    }
+  }
+
+  // Writes records records to path
+  void write(const std::string& path, const uint64_t& records) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open()) throw std::runtime_error("Could not open file " + path + ".");
+
+    std::string buffer = "## This file was generated by code using data from another file.\n\nWord\\Cob\\WordSyl\\PhonSylCLX\n";
+    std::uniform_int_distribution<uint64_t> pickRank(1, records > 0 ? records : 1);
+    std::string word;
+    std::string wordSyl;
+    std::string pronunciation;
+
+    uint64_t written = 0;
+    while(written < records) {
+      word.clear();
+      wordSyl.clear();
+      pronunciation.clear();
+
+      const int length = pickLength(random) + 1;
+      std::vector<size_t> breaks; // Where each syllable of the word starts
+      for(int i = 0; i < length; ++i) {
+        if(i > 0) {
+          wordSyl += '-';
+          pronunciation += '-';
+        }
+        breaks.push_back(word.length());
+        std::string spelling;
+        _syllable(pronunciation, spelling);
+        word += spelling;
+        wordSyl += spelling;
+      }
+      if(word.empty()) continue;
+
+      if(_happens(options.uppercase)) {
+        word[0] = (char)std::toupper((unsigned char)word[0]);
+        wordSyl[0] = word[0];
+      }
+      if(_happens(options.nonalpha) && word.length() > 1) {
+        static const char marks[3] = {'\'', '-', ' '};
+        const size_t at = 1 + random() % (word.length() - 1);
+        word.insert(at, 1, marks[random() % 3]);
+      }
+
+      int variations = 1;
+      while(variations < maxVariations && _happens(options.duplicates)) {
+        ++variations;
+      }
+      for(int v = 0; v < variations && written < records; ++v) {
+        if(v > 0) {
+          // Another pronunciation, with one syllable said differently
+          std::vector<std::string_view> syls;
+          StringFunctions::splitView(pronunciation, '-', syls);
+          const size_t changed = random() % syls.size();
+          std::string other;
+          for(size_t i = 0; i < syls.size(); ++i) {
+            if(i > 0) other += '-';
+            if(i == changed) {
+              std::string ignored;
+              _syllable(other, ignored);
+            } else {
+              other += syls[i];
+            }
+          }
+          pronunciation = other;
+        }
+
+        uint64_t count = 0;
+        if(!_happens(options.zeros)) {
+          count = std::max<uint64_t>(1, (uint64_t)std::floor(options.top / std::pow((double)pickRank(random), options.zipf)));
+        }
+        buffer += word;
+        buffer += '\\';
+        buffer += std::to_string(count);
+        buffer += '\\';
+        buffer += wordSyl;
+        buffer += '\\';
+        buffer += pronunciation;
+        buffer += '\n';
+        ++written;
+      }
+
+      if(buffer.length() >= 1 << 20) {
+        file.write(buffer.data(), buffer.length());
+        buffer.clear();
+      }
+    }
+
+    file.write(buffer.data(), buffer.length());
+    if(!file) throw std::runtime_error("Could not write file " + path + ".");
+  }
+};
+
+
+int main(int argc, char** argv) {
+  if(argc < 3 || argc % 2 == 0) {
+    std::cout << "Usage: generator <path> <records> [--option value]..." << std::endl;
+    return 1;
+  }
+
+  try {
+    const std::string path = argv[1];
+    const uint64_t records = std::stoull(argv[2]);
+
+    Generator::Options options;
+    for(int i = 3; i + 1 < argc; i += 2) {
+      const std::string name = argv[i];
+      const std::string value = argv[i + 1];
+      if(name == "--seed") options.seed = std::stoull(value);
+      else if(name == "--zipf") options.zipf = std::stod(value);
+      else if(name == "--top") options.top = std::stod(value);
+      else if(name == "--zeros") options.zeros = std::stod(value);
+      else if(name == "--duplicates") options.duplicates = std::stod(value);
+      else if(name == "--uppercase") options.uppercase = std::stod(value);
+      else if(name == "--nonalpha") options.nonalpha = std::stod(value);
+      else if(name == "--quotes") options.quotes = std::stod(value);
+      else if(name == "--celex") options.celex = std::stod(value);
+      else if(name == "--novel") options.novel = std::stod(value);
+      else if(name == "--syllables") options.syllables = value;
+      else if(name == "--phonemes") options.phonemes = value;
+      else throw std::invalid_argument("Unknown option " + name + ".");
+    }
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    Generator generator(options);
+    generator.write(path, records);
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    int duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << "Wrote " << records << " records to " << path << ". Duration: " << duration << "ms" << std::endl;
+  } catch(const std::exception& e) {
+    std::cout << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
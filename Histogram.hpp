@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+
+/* Weighted counts of every byte value, kept in flat arrays with 64-bit
+   totals so large corpora can't overflow them. Adding a string is a
+   straight loop with no branches or lookups; each character is two
+   indexed adds. */
+class Histogram {
+private:
+  uint64_t totals[256];
+  uint64_t occurrences[256];
+
+public:
+  Histogram() : totals(), occurrences() {}
+
+  // Adds weight for every character of str
+  void add(std::string_view str, const uint64_t& weight) {
+    const unsigned char* p = (const unsigned char*)str.data();
+    for(size_t i = 0; i < str.length(); ++i) {
+      totals[p[i]] += weight;
+      occurrences[p[i]] += 1;
+    }
+  }
+
+  // Adds everything added to other
+  void merge(const Histogram& other) {
+    for(size_t c = 0; c < 256; ++c) {
+      totals[c] += other.totals[c];
+      occurrences[c] += other.occurrences[c];
+    }
+  }
+
+  // Sum of the weights added for c
+  uint64_t total(const char& c) const { return totals[(unsigned char)c]; }
+  // Number of times c has been added
+  uint64_t count(const char& c) const { return occurrences[(unsigned char)c]; }
+};
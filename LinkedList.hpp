@@ -1,30 +1,72 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
 #include <exception>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "Allocators.hpp"
+#include "ThreadPool.hpp"
+#include "Sorting.hpp"
+#include "Reduction.hpp"
+#include "PositionIndex.hpp"
 
-template<typename T> class list {
+
+// Alloc is the allocation policy used for both nodes and values (see Allocators.hpp)
+template<typename T, template<typename> class Alloc = heapAllocator> class list {
 private:
   struct node;
+  struct nodeWeight;
+  typedef PositionIndex<node, nodeWeight> Index;
   template<typename Compare = std::less<>> class mergeSort;
 
   node* first;
   node* last;
   size_t length;
 
+  Alloc<node> nodes;
+  Alloc<T> values;
+
+  // Optional tree over the nodes by position (see PositionIndex.hpp), kept
+  // up to date by every change, so lookups never write to the list
+  bool indexed;
+  Index positions;
+
+  node* _newNode(T* const value, node* const prev = nullptr, node* const next = nullptr) {
+    return nodes.create(value, prev, next);
+  }
+  void _deleteNode(node* const p) {
+    values.destroy(p->value);
+    nodes.destroy(p);
+  }
+
   void _clear() {
     node* p = first;
     node* nextp;
-    while(p != nullptr) {
-      nextp = p->next;
-      delete p;
-      p = nextp;
+    if(Alloc<T>::bulkRelease && std::is_trivially_destructible<T>::value) {
+      // Nothing to run per element, so hand back the memory in one go
+    } else if(Alloc<T>::bulkRelease) {
+      while(p != nullptr) {
+        p->value->~T();
+        p = p->next;
+      }
+    } else {
+      while(p != nullptr) {
+        nextp = p->next;
+        _deleteNode(p);
+        p = nextp;
+      }
     }
+    nodes.release();
+    values.release();
+
     first = nullptr;
     last = nullptr;
     length = 0;
+    positions.clear();
   }
 
   static node* _incrementBy(node* start, const size_t elements) {
@@ -40,37 +82,70 @@ private:
     return start;
   }
 
-  node* _findNode(const size_t index) {
-    node* p = first;
-    for(size_t i = 0; i < index; ++i) {
-      p = p->next;
+  // Same as _incrementBy, but through the index if start is in one
+  template<typename Node>
+  static Node* _advance(Node* start, const size_t elements) {
+    if(start != nullptr && Index::contains(start)) {
+      size_t offset = 0;
+      return Index::advance(start, offset, elements);
     }
-    return p;
+    return _incrementBy(start, elements);
   }
-  const node* _findNode(const size_t index) const {
-    const node* p = first;
-    for(size_t i = 0; i < index; ++i) {
-      p = p->next;
+
+  // Indexes the nodes if the list is indexed, or marks them as not indexed
+  void _reindex() {
+    if(indexed) {
+      positions.build(first);
+    } else {
+      positions.drop(first);
+    }
+  }
+
+  // Adds p, already linked into the list, to the index
+  void _indexNew(node* const p) {
+    if(indexed) {
+      positions.insertAfter(p->prev, p);
     }
-    return p;
   }
 
-  node* _findLast() {
-    return _findNode(length - 1);
+  // Takes p, which is about to be deleted, out of the index
+  void _unindex(node* const p) {
+    if(indexed) {
+      positions.erase(p);
+    }
   }
-  const node* _findLast() const {
-    return _findNode(length - 1);
+
+  // Looks the position up in the index, or walks from whichever end of the list is closer
+  template<typename Node>
+  Node* _findNode(const size_t index, Node* front, Node* back) const {
+    if(indexed) {
+      size_t offset;
+      return positions.find(index, offset);
+    }
+
+    Node* p;
+    if(index < length / 2) {
+      p = front;
+      for(size_t i = 0; i < index; ++i) {
+        p = p->next;
+      }
+    } else {
+      p = back;
+      for(size_t i = length - 1; i > index; --i) {
+        p = p->prev;
+      }
+    }
+    return p;
   }
+  node* _findNode(const size_t index) { return _findNode<node>(index, first, last); }
+  const node* _findNode(const size_t index) const { return _findNode<const node>(index, first, last); }
 
   void _resize(const size_t size, const T* const value) {
     if(length > size) {
       if(size <= 0) {
         _clear();
       } else {
-        node* p = first;
-        for(size_t i = 0; i < size - 1; ++i) {
-          p = p->next;
-        }
+        node* p = _findNode(size - 1);
         last = p;
 
         node* nextp;
@@ -79,71 +154,71 @@ private:
         for(size_t i = size; i < length; ++i) {
           p = nextp;
           nextp = p->next;
-          delete p;
+          _unindex(p);
+          _deleteNode(p);
         }
 
         length = size;
       }
     } else if(length < size) {
-      node* p = last;
-
       if(value == nullptr) {
-        for(size_t i = length - 1; i < size - 1; ++i) {
-          p->next = new node;
-          p = p->next;
+        while(length < size) {
+          _add(values.create());
         }
       } else {
-        for(size_t i = length - 1; i < size - 1; ++i) {
-          p->next = new node(new T(*value));
-          p = p->next;
+        while(length < size) {
+          _add(values.create(*value));
         }
       }
-
-      last = p;
-      length = size;
     }
   }
 
   void _add(T* const value) {
     if(length == 0) {
-      first = new node(value);
+      first = _newNode(value);
       last = first;
       length++;
     } else {
-      last->next = new node(value);
+      last->next = _newNode(value, last);
       last = last->next;
       length++;
     }
+    _indexNew(last);
   }
 
   void _insert(const size_t index, T* const value) {
     if(index == length) {
       _add(value);
     } else if(index == 0) {
-      first = new node(value, first);
+      first = _newNode(value, nullptr, first);
+      first->next->prev = first;
       length++;
+      _indexNew(first);
     } else {
       node* p = _findNode(index - 1);
-      p->next = new node(value, p->next);
+      p->next = _newNode(value, p, p->next);
+      p->next->next->prev = p->next;
       length++;
+      _indexNew(p->next);
     }
   }
 
   void _pop() {
     if(length == 1) {
       // Delete the only element
-      delete first;
+      _unindex(first);
+      _deleteNode(first);
       first = nullptr;
       last = nullptr;
       length = 0;
     } else if(length > 1) {
       // Delete the last element
-      delete last;
+      node* p = last;
+      last = last->prev;
+      _unindex(p);
+      _deleteNode(p);
       length--;
 
-      // Find the new last element
-      last = _findLast();
-
       // Clear its now-deleted next node
       last->next = nullptr;
     }
@@ -155,12 +230,16 @@ private:
       last = ptr;
     }
 
-    delete ptr->value;
+    values.destroy(ptr->value);
     ptr->value = p->value;
     ptr->next = p->next;
+    if(ptr->next != nullptr) {
+      ptr->next->prev = ptr;
+    }
 
-    p->value = nullptr;
-    delete p;
+    // ptr takes p's value, so p's place in the index is the one that goes
+    _unindex(p);
+    nodes.destroy(p);
     length--;
   }
   void _remove(node*& ptr) {
@@ -178,34 +257,43 @@ public:
   class const_iterator;
   class OutOfRange;
 
-  list<T>() : first(nullptr), last(nullptr), length(0) {}
+  list() : first(nullptr), last(nullptr), length(0), indexed(false) {}
 
   /* Deep Copy */
-  list<T>(const list<T>& other) : first(nullptr), last(nullptr), length(other.length) {
+  list(const list& other) : first(nullptr), last(nullptr), length(other.length), indexed(other.indexed) {
     if(length != 0) {
       node* otherp = other.first; // Always one ahead of thisp
-      node* thisp = new node(new T(*otherp->value));
+      node* thisp = _newNode(values.create(*otherp->value));
       first = thisp;
 
       otherp = otherp->next;
       while(otherp != nullptr) {
-        thisp->next = new node(new T(*otherp->value));
+        thisp->next = _newNode(values.create(*otherp->value), thisp);
         thisp = thisp->next;
         otherp = otherp->next;
       }
       last = thisp;
     }
+    if(indexed) {
+      positions.build(first);
+    }
+  }
+
+  /* Takes other's nodes and leaves it empty */
+  list(list&& other) : list() {
+    indexed = other.indexed;
+    other.transferTo(*this);
   }
 
   /* Deep Copy */
-  list<T>& operator=(const list<T>& other) {
+  list& operator=(const list& other) {
     if(this == &other) {
       return *this;
     }
 
     // Add a first node if it doesn't have one
     if(length == 0) {
-      first = new node;
+      first = _newNode(nullptr);
     }
     // Shorten it if necessary
     if(length > other.length) {
@@ -216,8 +304,8 @@ public:
     node* thisp = first;
     node* otherp = other.first;
     while(true) {
-      delete thisp->value;
-      thisp->value = new T(*otherp->value);
+      values.destroy(thisp->value);
+      thisp->value = values.create(*otherp->value);
 
       if(thisp->next == nullptr) break;
       thisp = thisp->next;
@@ -227,24 +315,26 @@ public:
     // thisp->next should now be nullptr
     otherp = otherp->next; // Set otherp to one ahead of thisp
     while(otherp != nullptr) {
-      thisp->next = new node(new T(*otherp->value));
+      thisp->next = _newNode(values.create(*otherp->value), thisp);
       thisp = thisp->next;
       otherp = otherp->next;
     }
     last = thisp;
     length = other.length;
-    
+    if(indexed) {
+      positions.build(first);
+    }
+
+    return *this;
+  }
+
+  list& operator=(list&& other) {
+    other.transferTo(*this);
     return *this;
   }
 
   ~list() {
-    node* p = first;
-    node* nextp;
-    while(p != nullptr) {
-      nextp = p->next;
-      delete p;
-      p = nextp;
-    }
+    _clear();
   }
 
   iterator begin() { return iterator(first); }
@@ -255,6 +345,20 @@ public:
 
   size_t size() const { return length; }
 
+  // Keeps an index so operator[], at, insert and remove by position, and
+  // iterator + n, take O(log n). Every change then updates it in O(log n)
+  // as well, and each node carries its links, so lists that are only
+  // appended to and walked are better off without it. Lookups don't change
+  // it, so they can run concurrently.
+  void setIndexed(const bool& enable) {
+    if(enable == indexed) {
+      return;
+    }
+    indexed = enable;
+    _reindex();
+  }
+  bool isIndexed() const { return indexed; }
+
   T& operator[](const size_t index) { return *_findNode(index)->value; }
   const T& operator[](const size_t index) const { return *_findNode(index)->value; }
 
@@ -280,14 +384,24 @@ public:
   void resize(const size_t size, const T& value) { _resize(size, &value); }
 
   void add(const T& value) {
-    _add(new T(value));
+    _add(values.create(value));
+  }
+  void add(T&& value) {
+    _add(values.create(std::move(value)));
+  }
+
+  // Constructs the new last value in place from args
+  template<typename... Args>
+  T& emplace_back(Args&&... args) {
+    _add(values.create(std::forward<Args>(args)...));
+    return *last->value;
   }
 
   void insert(const size_t index, const T& value) {
     if(index < 0 || index > length) {
       throw OutOfRange(length, index);
     }
-    _insert(index, new T(value));
+    _insert(index, values.create(value));
   }
 
   void pop() { _pop(); }
@@ -320,75 +434,180 @@ public:
     other.first = first;
     other.last = last;
     other.length = length;
-    
+    other.nodes.swap(nodes);
+    other.values.swap(values);
+    other.positions = positions;
+
     first = nullptr;
     last = nullptr;
     length = 0;
+    positions.clear();
+
+    if(other.indexed != indexed) {
+      other._reindex();
+    }
   }
 
-  // Reverses the order of the list
-  void reverse() {
-    if(length == 0) return;
+  // Moves the data in list other to the end of this list without copying it, leaving other empty
+  void splice(list& other) {
+    if(this == &other || other.length == 0) {
+      return;
+    }
 
-    node* head = first->next;
-    first->next = nullptr;
-    last = first;
+    if(indexed) {
+      node* prev = last;
+      for(node* p = other.first; p != nullptr; p = p->next) {
+        positions.insertAfter(prev, p);
+        prev = p;
+      }
+    } else if(other.indexed) {
+      other.positions.drop(other.first);
+    }
 
-    node* p;
-    while(head != nullptr) {
-      p = first;
-      first = head;
-      head = head->next;
-      first->next = p;
+    if(length == 0) {
+      first = other.first;
+    } else {
+      last->next = other.first;
+      other.first->prev = last;
     }
+    last = other.last;
+    length += other.length;
+    nodes.adopt(other.nodes);
+    values.adopt(other.values);
+
+    other.first = nullptr;
+    other.last = nullptr;
+    other.length = 0;
+    other.positions.clear();
   }
 
+  // Reverses the order of the list
+  void reverse() {
+    node* p = first;
+    while(p != nullptr) {
+      std::swap(p->prev, p->next);
+      p = p->prev;
+    }
+    std::swap(first, last);
+    if(indexed) {
+      positions.build(first);
+    }
+  }
+
+  // Large lists are sorted on the shared thread pool. Either way the order
+  // is the same, with equal values in the reverse of their original order.
   template<typename Compare = std::less<>>
   void sort(Compare comp = Compare()) {
+    sort(comp, ThreadPool::shared());
+  }
+  template<typename Compare>
+  void sort(Compare comp, ThreadPool& pool) {
+    if(length == 0) return;
+
     mergeSort<Compare> s(first, comp);
-    s.sort();
+    if(pool.size() > 1 && length >= Sorting::parallelThreshold) {
+      last = s.sort(pool, length);
+    } else {
+      last = s.sort();
+    }
+    if(indexed) {
+      positions.build(first);
+    }
+  }
+
+  // Radix sort on the integer returned by key. Takes linear time and gives
+  // the same order as sort() with the matching comparison, ties included.
+  template<typename KeyFunction>
+  void sortByKey(KeyFunction key, const bool& descending = false) {
+    if(length < 2) return;
 
-    last = _findLast();
+    typedef decltype(Sorting::radixKey(key(*first->value), descending)) Unsigned;
+    std::vector<std::pair<Unsigned, node*>> entries;
+    entries.reserve(length);
+    // Gathered back to front, so the stable sort leaves ties reversed like sort()
+    for(node* p = last; p != nullptr; p = p->prev) {
+      entries.emplace_back(Sorting::radixKey(key(*p->value), descending), p);
+    }
+
+    Sorting::radixSort(entries);
+
+    first = entries[0].second;
+    first->prev = nullptr;
+    for(size_t i = 1; i < entries.size(); ++i) {
+      entries[i - 1].second->next = entries[i].second;
+      entries[i].second->prev = entries[i - 1].second;
+    }
+    last = entries.back().second;
+    last->next = nullptr;
+    if(indexed) {
+      positions.build(first);
+    }
+  }
+
+  // Folds the values into a copy of init with add(result, value), in order.
+  // Large lists are split into one run per thread of the shared pool, and
+  // the runs' results are merged from left to right with merge(left, right),
+  // which must give the same result as adding the right run's values.
+  template<typename Result, typename Add, typename Merge>
+  Result reduce(const Result& init, Add add, Merge merge) const {
+    return reduce(init, add, merge, ThreadPool::shared());
+  }
+  template<typename Result, typename Add, typename Merge>
+  Result reduce(const Result& init, Add add, Merge merge, ThreadPool& pool) const {
+    const size_t parts = Reduction::parts(length, pool);
+    std::vector<const node*> starts(parts);
+    const node* p = first;
+    for(size_t i = 0; i < parts; ++i) {
+      starts[i] = p;
+      p = _incrementBy(p, length * (i + 1) / parts - length * i / parts);
+    }
+
+    return Reduction::combine(parts, init, [&](const size_t i, Result& result) {
+      const node* q = starts[i];
+      for(size_t j = length * i / parts; j < length * (i + 1) / parts; ++j) {
+        add(result, *q->value);
+        q = q->next;
+      }
+    }, merge, pool);
   }
 
   bool checkLast() const {
-    const node* finalNode = _findLast();
-    return (finalNode->next == nullptr);
+    if(length == 0) {
+      return first == nullptr && last == nullptr;
+    }
+    // Walk forwards so a broken next chain is caught
+    const node* finalNode = _incrementBy(first, length - 1);
+    return (finalNode == last && finalNode->next == nullptr);
   }
 };
 
 
-template<typename T> struct list<T>::node {
+// Values are owned by the list, which creates and destroys them through its allocator
+template<typename T, template<typename> class Alloc> struct list<T, Alloc>::node {
   T* value;
+  node* prev;
   node* next;
 
-  node() : value(nullptr), next(nullptr) {}
-  node(T* const value) : value(value), next(nullptr) {}
-  node(T* const value, node* const next) : value(value), next(next) {}
+  // Links in the list's index, if it has one (see PositionIndex.hpp)
+  node* up;
+  node* left;
+  node* right;
+  size_t total;
+  uint32_t priority;
 
-  node(const node& other) : next(nullptr) { // Deep Copy
-    value = new T(*other.value);
-  }
-  node& operator=(const node& other) { // Deep Copy
-    if(value == other.value) {
-      return *this;
-    }
-
-    delete value;
-    value = new T(other.value);
-    next = other.next;
-    return *this;
-  }
+  node() : node(nullptr) {}
+  node(T* const value) : node(value, nullptr, nullptr) {}
+  node(T* const value, node* const prev, node* const next) : value(value), prev(prev), next(next), up(nullptr), left(nullptr), right(nullptr), total(0), priority(0) {}
+};
 
-  ~node() {
-    delete value;
-  }
+template<typename T, template<typename> class Alloc> struct list<T, Alloc>::nodeWeight {
+  static size_t of(const node*) { return 1; }
 };
 
 
-template<typename T> class list<T>::iterator {
+template<typename T, template<typename> class Alloc> class list<T, Alloc>::iterator {
   using iterator_category = std::forward_iterator_tag;
-  friend class list<T>;
+  friend class list;
 
 private:
   node* ptr;
@@ -430,8 +649,8 @@ public:
   bool operator<(const iterator& other) const { return ptr < other.ptr; }
   bool operator>(const iterator& other) const { return ptr > other.ptr; }
 
-  iterator operator+(int other) const { return _incrementBy(ptr, other); }
-  iterator operator+(const size_t other) const { return _incrementBy(ptr, other); }
+  iterator operator+(int other) const { return _advance(ptr, (size_t)other); }
+  iterator operator+(const size_t other) const { return _advance(ptr, other); }
 
   operator bool() const { return ptr != nullptr; }
   bool isnull() const { return ptr == nullptr; }
@@ -441,9 +660,9 @@ public:
   void clear() const { ptr = nullptr; }
 };
 
-template<typename T> class list<T>::const_iterator {
+template<typename T, template<typename> class Alloc> class list<T, Alloc>::const_iterator {
   using iterator_category = std::forward_iterator_tag;
-  friend class list<T>;
+  friend class list;
 
 private:
   const node* ptr;
@@ -480,8 +699,8 @@ public:
   bool operator<(const const_iterator& other) const { return ptr < other.ptr; }
   bool operator>(const const_iterator& other) const { return ptr > other.ptr; }
 
-  const_iterator operator+(int other) const { return _incrementBy(ptr, other); }
-  const_iterator operator+(const size_t other) const { return _incrementBy(ptr, other); }
+  const_iterator operator+(int other) const { return _advance(ptr, (size_t)other); }
+  const_iterator operator+(const size_t other) const { return _advance(ptr, other); }
 
   operator bool() const { return ptr != nullptr; }
   bool isnull() const { return ptr == nullptr; }
@@ -498,8 +717,8 @@ public:
 };
 
 
-template<typename T>
-class list<T>::OutOfRange : public std::exception
+template<typename T, template<typename> class Alloc>
+class list<T, Alloc>::OutOfRange : public std::exception
 {
   std::string msg;
 
@@ -517,9 +736,9 @@ public:
 };
 
 
-template<typename T>
+template<typename T, template<typename> class Alloc>
 template<typename Compare>
-class list<T>::mergeSort {
+class list<T, Alloc>::mergeSort {
 private:
   node** start;
   Compare compare;
@@ -543,60 +762,123 @@ private:
     slow->next = nullptr;
   }
 
-  // Merge two sorted linked lists
-  node* _mergeLists(node* a, node* b) {
+  // Merge two sorted linked lists, relinking prev pointers as it goes
+  node* _mergeLists(node* a, node* aTail, node* b, node* bTail, node** tailRef) {
     node* result = nullptr;
     node** end = &result;
+    node* prev = nullptr;
 
     while(a && b) {
       if (compare(*a->value, *b->value)) {
         *end = a;
         a = a->next;
-        end = &(*end)->next;
       } else {
         *end = b;
         b = b->next;
-        end = &(*end)->next;
       }
+      (*end)->prev = prev;
+      prev = *end;
+      end = &(*end)->next;
     }
 
     if(a == nullptr) {
       *end = b;
+      *tailRef = (b == nullptr) ? prev : bTail;
     } else {
       *end = a;
+      *tailRef = aTail;
+    }
+    if(*end != nullptr) {
+      (*end)->prev = prev;
     }
 
     return result;
   }
 
   // Main Merge Sort function
-  void _sort(node** headRef) {
+  void _sort(node** headRef, node** tailRef) {
     node* head = *headRef;
     if (head == nullptr || head->next == nullptr) {
+      *tailRef = head;
       return;
     }
 
     node* a;
     node* b;
+    node* aTail;
+    node* bTail;
 
     // Split the list into two halves
     _splitList(head, &a, &b);
 
     // Recursively sort the two halves
-    _sort(&a);
-    _sort(&b);
+    _sort(&a, &aTail);
+    _sort(&b, &bTail);
 
     // Merge the sorted halves
-    *headRef = _mergeLists(a, b);
+    *headRef = _mergeLists(a, aTail, b, bTail, tailRef);
   }
 
 public:
   mergeSort(node*& start, Compare comp = Compare()) : start(&start), compare(comp) {}
-  mergeSort(list<T>& linkedlist, Compare comp = Compare()) : start(&linkedlist.first), compare(comp) {}
+  mergeSort(list& linkedlist, Compare comp = Compare()) : start(&linkedlist.first), compare(comp) {}
+
+  // Sorts list and returns its new last element
+  node* sort() {
+    node* tail;
+    _sort(start, &tail);
+    return tail;
+  }
+
+  // Same as sort(), but the top levels of the recursion run on the pool.
+  // Runs are cut at the same sizes _splitList would give, so the result
+  // is identical to the single-threaded sort.
+  node* sort(ThreadPool& pool, const size_t length) {
+    size_t runs = 1;
+    std::vector<size_t> sizes = { length };
+    while(runs < pool.size()) {
+      std::vector<size_t> halves;
+      for(const size_t& s : sizes) {
+        halves.push_back((s + 1) / 2);
+        halves.push_back(s / 2);
+      }
+      sizes.swap(halves);
+      runs *= 2;
+    }
+
+    // Cut the list into runs
+    std::vector<node*> heads(runs, nullptr);
+    std::vector<node*> tails(runs, nullptr);
+    node* p = *start;
+    for(size_t i = 0; i < runs; ++i) {
+      if(sizes[i] == 0) continue;
+
+      heads[i] = p;
+      p->prev = nullptr;
+      p = _incrementBy(p, sizes[i] - 1);
+      node* nextp = p->next;
+      p->next = nullptr;
+      p = nextp;
+    }
+
+    pool.run(runs, [&](const size_t i) {
+      _sort(&heads[i], &tails[i]);
+    });
+
+    // Merge neighbouring runs, as the recursion would on its way back up
+    while(runs > 1) {
+      std::vector<node*> mergedHeads(runs / 2);
+      std::vector<node*> mergedTails(runs / 2);
+      pool.run(runs / 2, [&](const size_t i) {
+        mergedHeads[i] = _mergeLists(heads[2 * i], tails[2 * i], heads[2 * i + 1], tails[2 * i + 1], &mergedTails[i]);
+      });
+      heads.swap(mergedHeads);
+      tails.swap(mergedTails);
+      runs /= 2;
+    }
 
-  // Sorts list. Doesn't update last element.
-  void sort() {
-    _sort(start);
+    *start = heads[0];
+    return tails[0];
   }
 };
 
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #define MAPPED_FILE_POSIX
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#else
+  #include <fstream>
+  #include <sstream>
+#endif
+
+
+/* Read-only view of a whole file. On POSIX systems the file is memory
+   mapped, elsewhere it is read into a buffer. */
+class MappedFile {
+private:
+  const char* text;
+  size_t length;
+  bool opened;
+#ifdef MAPPED_FILE_POSIX
+  void* mapping;
+#else
+  std::string buffer;
+#endif
+
+public:
+  MappedFile(const std::string& path) : text(nullptr), length(0), opened(false) {
+#ifdef MAPPED_FILE_POSIX
+    mapping = nullptr;
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return;
+
+    struct stat info;
+    if(::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+      ::close(fd);
+      return;
+    }
+
+    length = (size_t)info.st_size;
+    if(length > 0) {
+      void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(p == MAP_FAILED) {
+        ::close(fd);
+        length = 0;
+        return;
+      }
+      ::madvise(p, length, MADV_SEQUENTIAL);
+      mapping = p;
+      text = (const char*)p;
+    }
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+    opened = true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open()) return;
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    buffer = contents.str();
+    text = buffer.data();
+    length = buffer.size();
+    opened = true;
+#endif
+  }
+
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator=(const MappedFile& other) = delete;
+
+  ~MappedFile() {
+#ifdef MAPPED_FILE_POSIX
+    if(mapping != nullptr) {
+      ::munmap(mapping, length);
+    }
+#endif
+  }
+
+  bool isOpen() const { return opened; }
+
+  size_t size() const { return length; }
+  std::string_view view() const { return std::string_view(text, length); }
+
+  // Lets the system drop the pages that lie entirely between offsets begin
+  // and end. They are read from the file again if they are used later.
+  void release(const size_t begin, const size_t end) const {
+#ifdef MAPPED_FILE_POSIX
+    if(mapping == nullptr) return;
+
+    const size_t page = (size_t)::sysconf(_SC_PAGESIZE);
+    const size_t from = (begin + page - 1) / page * page;
+    const size_t to = (end < length ? end : length) / page * page;
+    if(from < to) {
+      ::madvise((char*)mapping + from, to - from, MADV_DONTNEED);
+    }
+#endif
+  }
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <mutex>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+
+/* Timings and counters the library records as it runs, so runs and builds
+   can be compared. A Timer started while another is running on the same
+   thread is recorded under it, so the spans form a tree, and a span that
+   runs several times adds up. Counters, like the bytes read, are added to
+   by name. Everything goes in one registry, Metrics::shared(), which is
+   written out as JSON or CSV at the end of a run.
+
+   Recording takes a lock, so timers and counters go around whole steps,
+   not inside loops or the parts of a parallel reduction. */
+class Metrics {
+public:
+  class Span {
+  public:
+    std::string name;
+    size_t parent; // Index of the span it ran under; the root is its own parent
+    std::vector<size_t> children; // In the order they first started
+    uint64_t calls;
+    int64_t total; // In nanoseconds
+    int64_t longest;
+
+    Span(const std::string& name, const size_t& parent) : name(name), parent(parent), calls(0), total(0), longest(0) {}
+  };
+
+  class Timer {
+  private:
+    Metrics& metrics;
+    size_t span;
+    size_t previous; // Span running on this thread before this one
+    std::chrono::steady_clock::time_point start;
+    int64_t elapsed;
+    bool running;
+
+  public:
+    // Recorded under the span running on this thread
+    Timer(const std::string& name, Metrics& metrics = Metrics::shared()) : Timer(name, current, metrics) {}
+    // Recorded under span parent (see running()), whatever is running on
+    // this thread, like a task a thread picks up while it waits on another
+    Timer(const std::string& name, const size_t& parent, Metrics& metrics = Metrics::shared()) : metrics(metrics), previous(current), elapsed(0), running(true) {
+      span = metrics._child(parent, name);
+      current = span;
+      start = std::chrono::steady_clock::now();
+    }
+
+    Timer(const Timer& other) = delete;
+    Timer& operator=(const Timer& other) = delete;
+
+    ~Timer() {
+      stop();
+    }
+
+    // Records the span if it hasn't been yet, and returns how long it took
+    // in nanoseconds
+    int64_t stop() {
+      if(running) {
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        metrics._record(span, elapsed);
+        current = previous;
+        running = false;
+      }
+      return elapsed;
+    }
+  };
+
+private:
+  mutable std::mutex mutex;
+  std::vector<Span> spans; // spans[0] is the root, which is never timed
+  std::vector<std::pair<std::string, int64_t>> counters; // In the order they were first added
+  std::time_t started;
+
+  // Span running on each thread, or the root
+  static inline thread_local size_t current = 0;
+
+  size_t _child(const size_t& parent, const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for(const size_t& c : spans[parent].children) {
+      if(spans[c].name == name) return c;
+    }
+    spans.emplace_back(name, parent);
+    spans[parent].children.push_back(spans.size() - 1);
+    return spans.size() - 1;
+  }
+
+  void _record(const size_t& span, const int64_t& duration) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Span& s = spans[span];
+    ++s.calls;
+    s.total += duration;
+    if(duration > s.longest) s.longest = duration;
+  }
+
+  std::string _path(size_t span) const {
+    std::string result = spans[span].name;
+    for(span = spans[span].parent; span != 0; span = spans[span].parent) {
+      result = spans[span].name + '/' + result;
+    }
+    return result;
+  }
+
+  // Every span but the root, parents before their children
+  std::vector<size_t> _order() const {
+    std::vector<size_t> result;
+    std::vector<size_t> pending(spans[0].children.rbegin(), spans[0].children.rend());
+    while(!pending.empty()) {
+      const size_t s = pending.back();
+      pending.pop_back();
+      result.push_back(s);
+      pending.insert(pending.end(), spans[s].children.rbegin(), spans[s].children.rend());
+    }
+    return result;
+  }
+
+  static std::string _quote(std::string_view str) {
+    std::string result = "\"";
+    for(const char& c : str) {
+      if(c == '"' || c == '\\') result += '\\';
+      result += c;
+    }
+    return result + '"';
+  }
+
+  static std::string _csv(std::string_view str) {
+    std::string result = "\"";
+    for(const char& c : str) {
+      if(c == '"') result += '"';
+      result += c;
+    }
+    return result + '"';
+  }
+
+  static std::string _micros(const int64_t& nanos) {
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(3) << nanos / 1000.0;
+    return result.str();
+  }
+
+public:
+  Metrics() : spans(1, Span("", 0)), started(std::time(nullptr)) {}
+
+  Metrics(const Metrics& other) = delete;
+  Metrics& operator=(const Metrics& other) = delete;
+
+  // The span running on this thread, for timers started elsewhere to be
+  // recorded under
+  static size_t running() { return current; }
+
+  // The registry the library records into
+  static Metrics& shared() {
+    static Metrics metrics;
+    return metrics;
+  }
+
+  // Adds value to the counter called name
+  void add(const std::string& name, const int64_t& value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for(std::pair<std::string, int64_t>& counter : counters) {
+      if(counter.first == name) {
+        counter.second += value;
+        return;
+      }
+    }
+    counters.emplace_back(name, value);
+  }
+
+  int64_t counter(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for(const std::pair<std::string, int64_t>& counter : counters) {
+      if(counter.first == name) return counter.second;
+    }
+    return 0;
+  }
+
+  // The spans as an indented tree in milliseconds, then the counters
+  std::string toString() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(3);
+    for(const size_t& s : _order()) {
+      int depth = 0;
+      for(size_t p = spans[s].parent; p != 0; p = spans[p].parent) {
+        ++depth;
+      }
+      result << std::string(2 * depth + 2, ' ') << spans[s].name << ": " << spans[s].total / 1e6 << "ms";
+      if(spans[s].calls > 1) {
+        result << " (" << spans[s].calls << " calls)";
+      }
+      result << '\n';
+    }
+    for(const std::pair<std::string, int64_t>& counter : counters) {
+      result << "  " << counter.first << ": " << counter.second << '\n';
+    }
+    return result.str();
+  }
+
+  /* Writes the run as JSON: when it started, the build, every span by its
+     path with its calls, total and longest time in microseconds, and the
+     counters. Returns false if the file can't be written. */
+  bool writeJSON(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream file(path, std::ios::trunc);
+    if(!file.is_open()) return false;
+
+    file << "{\n";
+    file << "  \"started\": " << (int64_t)started << ",\n";
+    file << "  \"build\": " << _quote(__DATE__ " " __TIME__) << ",\n";
+    file << "  \"spans\": [";
+    bool first = true;
+    for(const size_t& s : _order()) {
+      file << (first ? "\n" : ",\n");
+      file << "    {\"path\": " << _quote(_path(s)) << ", \"calls\": " << spans[s].calls << ", \"totalMicroseconds\": " << _micros(spans[s].total) << ", \"longestMicroseconds\": " << _micros(spans[s].longest) << "}";
+      first = false;
+    }
+    file << "\n  ],\n";
+    file << "  \"counters\": {";
+    first = true;
+    for(const std::pair<std::string, int64_t>& counter : counters) {
+      file << (first ? "\n" : ",\n");
+      file << "    " << _quote(counter.first) << ": " << counter.second;
+      first = false;
+    }
+    file << "\n  }\n";
+    file << "}\n";
+    return (bool)file;
+  }
+
+  /* Writes the run as CSV, one row per span and then one per counter. Spans
+     have their calls, total and longest time in microseconds, and counters
+     their value. */
+  bool writeCSV(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream file(path, std::ios::trunc);
+    if(!file.is_open()) return false;
+
+    file << "Kind,Name,Calls,TotalMicroseconds,LongestMicroseconds,Value\n";
+    for(const size_t& s : _order()) {
+      file << "span," << _csv(_path(s)) << ',' << spans[s].calls << ',' << _micros(spans[s].total) << ',' << _micros(spans[s].longest) << ",\n";
+    }
+    for(const std::pair<std::string, int64_t>& counter : counters) {
+      file << "counter," << _csv(counter.first) << ",,,," << counter.second << '\n';
+    }
+    return (bool)file;
+  }
+};
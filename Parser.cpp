@@ -1,32 +1,141 @@
 #include <string>
+#include <string_view>
 #include <vector>
+#include <algorithm>
 #include <unordered_map>
+#include <unordered_set>
+#include <memory>
 #include <exception>
 #include <fstream>
 
 #include "LinkedList.hpp"
+#include "UnrolledList.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+#include "SymbolTable.hpp"
+#include "PhonemeClassTable.hpp"
+#include "PhonemeAlphabet.hpp"
+#include "PhonemeReplacer.hpp"
+#include "ColumnarFile.hpp"
 #include "StringFunctions.hpp"
+#include "Metrics.hpp"
 
 
 #define deliminator '\\'
 
 
+/* Walks the records of a data file without copying it. Blank lines, lines
+   starting with ## and the header line are skipped, and a trailing \r is
+   dropped from every line. A reader can also cover just part of a file,
+   starting on a line after the header. */
+class RecordReader {
+private:
+  std::string_view text;
+  size_t pos;
+  int lineNum;
+  bool firstLine;
+  char delim;
+
+  // Pages of file are released once every releaseStep bytes have been read
+  static constexpr size_t releaseStep = 1 << 20;
+  const MappedFile* file;
+  size_t base;
+  size_t released;
+
+  // Gets the next line the way std::getline would. Returns false at the end.
+  bool _nextLine(std::string_view& line) {
+    if(file != nullptr && pos - released >= releaseStep) {
+      file->release(base + released, base + pos);
+      released = pos;
+    }
+    if(pos >= text.length()) return false;
+
+    size_t end = text.find('\n', pos);
+    if(end == std::string_view::npos) end = text.length();
+    line = text.substr(pos, end - pos);
+    pos = end + 1;
+    lineNum++;
+    return true;
+  }
+
+  // Gets the next line that isn't blank or a comment, without its \r
+  bool _nextContentLine(std::string_view& line) {
+    while(_nextLine(line)) {
+      if(line.empty()) continue;
+      if(line.length() > 1 && line[0] == '#' && line[1] == '#') continue;
+      if(line.back() == '\r') {
+        line.remove_suffix(1);
+      }
+      if(StringFunctions::onlyContains(line, ' ')) continue;
+      return true;
+    }
+    return false;
+  }
+
+public:
+  RecordReader(std::string_view text) : text(text), pos(0), lineNum(0), firstLine(true), delim(deliminator), file(nullptr), base(0), released(0) {}
+  // Reads a part of a file that comes after the header and starts on line lineNum + 1
+  RecordReader(std::string_view text, const int& lineNum) : text(text), pos(0), lineNum(lineNum), firstLine(false), delim(deliminator), file(nullptr), base(0), released(0) {}
+
+  // Lets the system drop the pages of file that have been read, so memory
+  // use doesn't grow with the size of the file. text must start at offset
+  // base of the file.
+  void releaseAsRead(const MappedFile& mapped, const size_t& offset) {
+    file = &mapped;
+    base = offset;
+  }
+
+  // For files that separate segments with something other than a backslash
+  void setDelimiter(const char& delimiter) {
+    delim = delimiter;
+  }
+
+  // Line number of the last line read, counting from 1
+  int line() const { return lineNum; }
+  // Offset of the first character that hasn't been read yet
+  size_t offset() const { return pos < text.length() ? pos : text.length(); }
+
+  // Reads up to and including the header line, if it hasn't been read yet
+  void skipHeader() {
+    std::string_view line;
+    if(firstLine && _nextContentLine(line)) {
+      firstLine = false;
+    }
+  }
+
+  // Splits the next record into segments, which point into the file.
+  // Throws if it doesn't have segmentCount segments or the second one isn't
+  // an integer. Returns false at the end of the file.
+  bool next(std::vector<std::string_view>& segments, const size_t segmentCount) {
+    skipHeader();
+
+    std::string_view line;
+    if(!_nextContentLine(line)) return false;
+
+    StringFunctions::splitView(line, delim, segments);
+
+    if(segments.size() != segmentCount) throw std::runtime_error("Wrong number of segments in line " + std::to_string(lineNum) + ". Segments found: " + std::to_string(segments.size()));
+    if(!StringFunctions::isInteger(segments[1])) throw std::runtime_error("Second segment of line " + std::to_string(lineNum) + " is not an integer.");
+    return true;
+  }
+};
+
+
 class Words {
 public:
   class Info {
   public:
     std::string word;
     int freqCount;
-    std::vector<std::string> syllables;
-    std::vector<std::string> pronunciation;
+    std::vector<int> syllables; // IDs in SymbolTable::spellings()
+    std::vector<int> pronunciation; // IDs in SymbolTable::pronunciations()
 
-    Info(const std::string& word, const int& freqCount, const std::vector<std::string>& syllables, const std::vector<std::string>& pronunciation) : word(word), freqCount(freqCount), syllables(syllables), pronunciation(pronunciation) {}
-    Info(const std::string& wordSeg, const std::string& freqSeg, const std::string& sylSeg, const std::string& pronSeg) {
-      word = wordSeg;
+    Info(std::string_view word, const int& freqCount, std::vector<int> syllables, std::vector<int> pronunciation) : word(word), freqCount(freqCount), syllables(std::move(syllables)), pronunciation(std::move(pronunciation)) {}
+    Info(std::string_view wordSeg, std::string_view freqSeg, std::string_view sylSeg, std::string_view pronSeg) : word(wordSeg) {
       if(!StringFunctions::isInteger(freqSeg)) throw std::invalid_argument("freqSeg argument of Info is not an integer.");
-      freqCount = std::stoi(freqSeg);
-      syllables = StringFunctions::split(sylSeg, '-');
-      pronunciation = StringFunctions::split(pronSeg, '-');
+      freqCount = StringFunctions::toInteger(freqSeg);
+      syllables = SymbolTable::spellings().internAll(sylSeg, '-');
+      pronunciation = SymbolTable::pronunciations().internAll(pronSeg, '-');
     }
 
     bool operator==(const Info& other) const {
@@ -55,31 +164,391 @@ public:
       std::string result;
       result += word + delim;
       result += std::to_string(freqCount) + delim;
-      result += StringFunctions::toString(syllables, '-') + delim;
-      result += StringFunctions::toString(pronunciation, '-');
+      result += SymbolTable::spellings().toString(syllables, '-') + delim;
+      result += SymbolTable::pronunciations().toString(pronunciation, '-');
       return result;
     }
 
     void removeQuotations() {
-      for(std::string& syl : pronunciation) {
-        if(StringFunctions::contains(syl, '\"')) {
-          syl = StringFunctions::remove(syl, '\"');
+      SymbolTable& table = SymbolTable::pronunciations();
+      for(int& syl : pronunciation) {
+        const std::string& name = table.name(syl);
+        if(StringFunctions::contains(name, '\"')) {
+          syl = table.intern(StringFunctions::remove(name, '\"'));
         }
       }
     }
   };
 
+  // A word whose record applyDelta() added, removed or replaced. A record
+  // that isn't there has a count of 0 and no syllables.
+  class Change {
+  public:
+    Info before;
+    Info after;
+
+    Change(Info before, Info after) : before(std::move(before)), after(std::move(after)) {}
+  };
+
   class Replacement {
   public:
-    char c;
+    std::string pattern;
     std::string replacement;
 
-    Replacement(const char& c, const std::string& replacement) : c(c), replacement(replacement) {}
+    Replacement(const char& c, const std::string& replacement) : pattern(1, c), replacement(replacement) {}
+    Replacement(const std::string& pattern, const std::string& replacement) : pattern(pattern), replacement(replacement) {}
   };
 
 private:
+  /* Replaces the phonemes of words that are kept and adds up how often
+     each syllable is used. Every thread reading the file has its own. */
+  class Curation {
+  private:
+    const PhonemeReplacer& replacer;
+    std::unordered_map<int, int> replaced; // Pronunciation IDs before and after replacing
+    std::string buffer;
+
+  public:
+    std::vector<int> counts; // Indexed by pronunciation ID
+
+    Curation(const PhonemeReplacer& replacer) : replacer(replacer) {}
+
+    void operator()(Info& word) {
+      for(int& syl : word.pronunciation) {
+        auto it = replaced.find(syl);
+        if(it == replaced.end()) {
+          it = replaced.emplace(syl, _replace(syl, replacer, buffer)).first;
+        }
+        syl = it->second;
+
+        if((size_t)syl >= counts.size()) {
+          counts.resize(syl + 1, 0);
+        }
+        counts[syl] += word.freqCount;
+      }
+    }
+  };
+
   std::string filePath;
-  list<Info> data;
+  unrolledList<Info, poolAllocator> data;
+
+  // Applies the replacements to a pronunciation syllable, using buffer
+  // to build the result
+  static int _replace(const int& syl, const PhonemeReplacer& replacer, std::string& buffer) {
+    SymbolTable& table = SymbolTable::pronunciations();
+    replacer.apply(table.name(syl), buffer);
+    return table.intern(buffer);
+  }
+
+  static PhonemeReplacer _replacer(const std::vector<Replacement>& replacements) {
+    PhonemeReplacer result;
+    for(const Replacement& r : replacements) {
+      result.addRule(r.pattern, r.replacement);
+    }
+    return result;
+  }
+
+  // Files are only split between threads into chunks of at least this many bytes
+  static constexpr size_t minChunkSize = 1 << 20;
+
+  /* Cache columns: word strings (0, 1), counts (2), written syllable pool
+     (3, 4) and the pool positions of each word's syllables (5, 6), then the
+     same for pronunciations (7, 8, 9, 10), and the words using each
+     pronunciation in the pool (11, 12) */
+  static constexpr uint32_t cacheKind = 1;
+
+  /* The words that used each pronunciation syllable when the list was
+     loaded from the cache, in order. They point into the cache, which is
+     kept open for them. */
+  class Users {
+  public:
+    std::shared_ptr<const Columnar::Reader> cache; // Null if the list wasn't loaded from one
+    Columnar::Strings words;
+    const int32_t* offsets;
+    const int32_t* values;
+    std::vector<int32_t> pool; // Pool position of each pronunciation ID, -1 if it isn't in the pool
+
+    Users() : offsets(nullptr), values(nullptr) {}
+  };
+  Users users;
+
+  // Adds the position of each syllable in a pool of distinct syllables to out
+  static void _pool(const SymbolTable& table, const std::vector<int>& ids, std::vector<int32_t>& positions, std::vector<std::string_view>& pool, std::vector<int32_t>& out) {
+    for(const int& id : ids) {
+      if(positions[id] < 0) {
+        positions[id] = (int32_t)pool.size();
+        pool.push_back(table.name(id));
+      }
+      out.push_back(positions[id]);
+    }
+  }
+
+  void _writeCache() const {
+    const SymbolTable& spellings = SymbolTable::spellings();
+    const SymbolTable& pronunciations = SymbolTable::pronunciations();
+
+    std::vector<std::string_view> words;
+    std::vector<int32_t> freqs;
+    std::vector<int32_t> spellPositions(spellings.size(), -1);
+    std::vector<int32_t> pronPositions(pronunciations.size(), -1);
+    std::vector<std::string_view> spellPool;
+    std::vector<std::string_view> pronPool;
+    std::vector<int32_t> sylOffsets(1, 0);
+    std::vector<int32_t> sylValues;
+    std::vector<int32_t> pronOffsets(1, 0);
+    std::vector<int32_t> pronValues;
+
+    for(const Info& i : data) {
+      words.push_back(i.word);
+      freqs.push_back(i.freqCount);
+      _pool(spellings, i.syllables, spellPositions, spellPool, sylValues);
+      sylOffsets.push_back((int32_t)sylValues.size());
+      _pool(pronunciations, i.pronunciation, pronPositions, pronPool, pronValues);
+      pronOffsets.push_back((int32_t)pronValues.size());
+    }
+
+    std::vector<std::vector<int32_t>> pronUsers(pronPool.size());
+    for(size_t i = 0; i + 1 < pronOffsets.size(); ++i) {
+      for(int32_t j = pronOffsets[i]; j < pronOffsets[i + 1]; ++j) {
+        std::vector<int32_t>& u = pronUsers[pronValues[j]];
+        if(u.empty() || u.back() != (int32_t)i) {
+          u.push_back((int32_t)i);
+        }
+      }
+    }
+    std::vector<int32_t> userOffsets(1, 0);
+    std::vector<int32_t> userValues;
+    for(const std::vector<int32_t>& u : pronUsers) {
+      userValues.insert(userValues.end(), u.begin(), u.end());
+      userOffsets.push_back((int32_t)userValues.size());
+    }
+
+    Columnar::Writer writer(cacheKind, data.size());
+    writer.addStrings(words);
+    writer.addInts(freqs);
+    writer.addStrings(spellPool);
+    writer.addInts(sylOffsets);
+    writer.addInts(sylValues);
+    writer.addStrings(pronPool);
+    writer.addInts(pronOffsets);
+    writer.addInts(pronValues);
+    writer.addInts(userOffsets);
+    writer.addInts(userValues);
+    writer.write(Columnar::cachePath(filePath), filePath);
+  }
+
+  // Loads the data from the cache next to the file. Returns false if there isn't a usable one.
+  bool _readCache() {
+    users = Users();
+    std::shared_ptr<Columnar::Reader> cache = std::make_shared<Columnar::Reader>(Columnar::cachePath(filePath), cacheKind, filePath);
+    if(!cache->isValid()) return false;
+
+    const size_t records = cache->records();
+    Columnar::Strings words;
+    Columnar::Strings spellPool;
+    Columnar::Strings pronPool;
+    const int32_t* freqs;
+    const int32_t* sylOffsets;
+    const int32_t* sylValues;
+    const int32_t* pronOffsets;
+    const int32_t* pronValues;
+    if(!cache->strings(0, words) || words.size() != records) return false;
+    if(!cache->ints(2, records, freqs)) return false;
+    if(!cache->strings(3, spellPool) || !cache->lists(5, records, spellPool.size(), sylOffsets, sylValues)) return false;
+    if(!cache->strings(7, pronPool) || !cache->lists(9, records, pronPool.size(), pronOffsets, pronValues)) return false;
+
+    // Only the distinct syllables need interning
+    std::vector<int> spellIds(spellPool.size());
+    for(size_t i = 0; i < spellPool.size(); ++i) {
+      spellIds[i] = SymbolTable::spellings().intern(spellPool[i]);
+    }
+    std::vector<int> pronIds(pronPool.size());
+    for(size_t i = 0; i < pronPool.size(); ++i) {
+      pronIds[i] = SymbolTable::pronunciations().intern(pronPool[i]);
+    }
+
+    data.clear();
+    for(size_t i = 0; i < records; ++i) {
+      std::vector<int> syllables;
+      syllables.reserve(sylOffsets[i + 1] - sylOffsets[i]);
+      for(int32_t j = sylOffsets[i]; j < sylOffsets[i + 1]; ++j) {
+        syllables.push_back(spellIds[sylValues[j]]);
+      }
+      std::vector<int> pronunciation;
+      pronunciation.reserve(pronOffsets[i + 1] - pronOffsets[i]);
+      for(int32_t j = pronOffsets[i]; j < pronOffsets[i + 1]; ++j) {
+        pronunciation.push_back(pronIds[pronValues[j]]);
+      }
+      data.emplace_back(words[i], freqs[i], std::move(syllables), std::move(pronunciation));
+    }
+
+    if(cache->lists(11, pronPool.size(), records, users.offsets, users.values)) {
+      users.cache = cache;
+      users.words = words;
+      users.pool.assign(SymbolTable::pronunciations().size(), -1);
+      for(size_t i = 0; i < pronPool.size(); ++i) {
+        users.pool[pronIds[i]] = (int32_t)i;
+      }
+    }
+    Metrics::shared().add("records read", records);
+    return true;
+  }
+
+  // Adds every record from reader to batch. If elim is set, records are
+  // filtered the way eliminate() does it and only the ones kept are built.
+  // Records are given to curation once they can't be replaced any more,
+  // except the first and last of the batch, which are left to _read().
+  // Returns the number of records read.
+  static size_t _parse(RecordReader& reader, unrolledList<Info, poolAllocator>& batch, const bool& elim, Curation* curation) {
+    std::vector<std::string_view> segments;
+    Info* first = nullptr; // First record kept
+    Info* last = nullptr; // Last record kept
+    size_t records = 0;
+
+    while(reader.next(segments, 4)) {
+      ++records;
+      if(!elim) {
+        batch.emplace_back(segments[0], segments[1], segments[2], segments[3]);
+        continue;
+      }
+
+      const std::string_view word = segments[0];
+      const int freqCount = StringFunctions::toInteger(segments[1]);
+
+      if(freqCount == 0) continue;
+      if(!StringFunctions::onlyAlphabetical(word)) continue;
+      if(!StringFunctions::isLowercase(word)) continue;
+      if(last != nullptr && word == last->word) { // Keep the more common variation of the word
+        if(freqCount > last->freqCount) {
+          *last = Info(segments[0], segments[1], segments[2], segments[3]);
+          last->removeQuotations();
+        }
+        continue;
+      }
+
+      if(curation != nullptr && last != nullptr && last != first) {
+        (*curation)(*last);
+      }
+
+      last = &batch.emplace_back(segments[0], segments[1], segments[2], segments[3]);
+      last->removeQuotations();
+      if(first == nullptr) {
+        first = last;
+      }
+    }
+    return records;
+  }
+
+  // Splits the file into newline-aligned chunks, parses one chunk per
+  // thread and joins the results in file order. If replacer is given, the
+  // words kept are curated and their syllables counted into sylCounts.
+  void _read(const bool& elim, ThreadPool& pool, const PhonemeReplacer* replacer = nullptr, std::vector<int>* sylCounts = nullptr) {
+    MappedFile file(filePath);
+    if(!file.isOpen()) {
+      throw std::invalid_argument("File path not valid.");
+    }
+
+    const std::string_view text = file.view();
+    RecordReader header(text);
+    header.skipHeader();
+    const std::string_view body = text.substr(header.offset());
+
+    const size_t chunks = std::max<size_t>(1, std::min(pool.size(), body.length() / minChunkSize));
+    std::vector<size_t> bounds(chunks + 1, body.length());
+    bounds[0] = 0;
+    for(size_t i = 1; i < chunks; ++i) {
+      const size_t newline = body.find('\n', std::max(body.length() * i / chunks, bounds[i - 1]));
+      bounds[i] = (newline == std::string_view::npos) ? body.length() : newline + 1;
+    }
+
+    // One per chunk, and one for the records curated while joining
+    std::vector<Curation> curations;
+    if(replacer != nullptr) {
+      curations.reserve(chunks + 1);
+      for(size_t i = 0; i <= chunks; ++i) {
+        curations.emplace_back(*replacer);
+      }
+    }
+
+    // Each chunk counts its lines from 0, and lines[i] is left at -1 if
+    // chunk i fails. If several chunks fail, the error from the earliest one
+    // is thrown.
+    std::vector<unrolledList<Info, poolAllocator>> batches(chunks);
+    std::vector<size_t> records(chunks, 0);
+    std::vector<int> lines(chunks, -1);
+    try {
+      pool.run(chunks, [&](const size_t i) {
+        RecordReader reader(body.substr(bounds[i], bounds[i + 1] - bounds[i]), 0);
+        reader.releaseAsRead(file, header.offset() + bounds[i]);
+        records[i] = _parse(reader, batches[i], elim, curations.empty() ? nullptr : &curations[i]);
+        lines[i] = reader.line();
+      });
+    } catch(const std::runtime_error&) {
+      // The chunks before the one that failed were read to the end, so the
+      // line it starts after is known. Reading it again from there throws
+      // the same error with the line number in the whole file.
+      int startLine = header.line();
+      size_t i = 0;
+      while(i < chunks && lines[i] >= 0) {
+        startLine += lines[i++];
+      }
+      if(i < chunks) {
+        RecordReader reader(body.substr(bounds[i], bounds[i + 1] - bounds[i]), startLine);
+        unrolledList<Info, poolAllocator> discarded;
+        _parse(reader, discarded, elim, nullptr);
+      }
+      throw;
+    }
+
+    Curation* curation = curations.empty() ? nullptr : &curations[chunks];
+    data.clear();
+    users = Users();
+    for(unrolledList<Info, poolAllocator>& batch : batches) {
+      bool firstCurated = false;
+
+      // A run of the same word can cross into the next chunk
+      if(elim && data.size() > 0 && batch.size() > 0 && batch.begin()->word == data.back().word) {
+        if(batch.begin()->freqCount > data.back().freqCount) {
+          data.back() = std::move(*batch.begin());
+        }
+        batch.remove(batch.begin());
+        firstCurated = true; // The record now first was curated by its chunk, unless it is also the last
+      }
+
+      if(curation != nullptr && batch.size() > 0) {
+        if(data.size() > 0) {
+          (*curation)(data.back());
+        }
+        if(!firstCurated && batch.size() > 1) {
+          (*curation)(*batch.begin());
+        }
+      }
+      data.splice(batch);
+    }
+
+    size_t total = 0;
+    for(const size_t& r : records) {
+      total += r;
+    }
+    Metrics::shared().add("bytes read", file.size());
+    Metrics::shared().add("records read", total);
+    if(elim) {
+      Metrics::shared().add("words eliminated", total - data.size());
+    }
+
+    if(curation != nullptr) {
+      if(data.size() > 0) {
+        (*curation)(data.back());
+      }
+
+      sylCounts->assign(SymbolTable::pronunciations().size(), 0);
+      for(const Curation& c : curations) {
+        for(size_t i = 0; i < c.counts.size(); ++i) {
+          (*sylCounts)[i] += c.counts[i];
+        }
+      }
+    }
+  }
 
 public:
   Words() : filePath("Words.txt") {}
@@ -89,14 +558,61 @@ public:
 
   void clear() {
     data.clear();
+    users = Users();
   }
 
   std::string getPath() const { return filePath; }
   void setPath(const std::string& path) { filePath = path; }
 
   int size() const { return data.size(); }
-  const list<Info>& getData() const { return data; }
+  const unrolledList<Info, poolAllocator>& getData() const { return data; }
   const Info& getInfoAt(const int& i) const { return data.at(i); }
+  // For callers that look records up by position, which then takes O(log n)
+  void setIndexed(const bool& enable) { data.setIndexed(enable); }
+
+  // Whether word a comes before word b once the words are sorted and reversed
+  static bool comesBefore(std::string_view a, std::string_view b) {
+    if(a.length() != b.length()) {
+      return a.length() > b.length();
+    }
+    for(size_t i = 0; i < a.length(); ++i) {
+      if(a[i] != b[i]) {
+        return a[i] > b[i];
+      }
+    }
+    return false;
+  }
+
+  // Position of word in the words sorted and reversed, or of the first word
+  // after it if it isn't there. Takes O(log^2 n) once the list is indexed.
+  size_t position(std::string_view word) const {
+    size_t low = 0;
+    size_t high = data.size();
+    while(low < high) {
+      const size_t mid = low + (high - low) / 2;
+      if(comesBefore(data[mid].word, word)) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  }
+
+  // Calls f with each word that used pronunciation syllable id when the list
+  // was loaded from the cache by read(), in order, until f returns false.
+  // Returns false if the list wasn't loaded from a cache.
+  template<typename Function>
+  bool forEachUserWhenRead(const int& id, Function f) const {
+    if(users.cache == nullptr) return false;
+    if(id < 0 || (size_t)id >= users.pool.size() || users.pool[id] < 0) return true;
+
+    const int32_t p = users.pool[id];
+    for(int32_t j = users.offsets[p]; j < users.offsets[p + 1]; ++j) {
+      if(!f(users.words[users.values[j]])) break;
+    }
+    return true;
+  }
 
   // REMOVE
   void checkLast() {
@@ -105,16 +621,21 @@ public:
     }
   }
   void sort() {
+    Metrics::Timer timer("Words::sort");
     // struct Compare { bool operator()(Words::Info a, Words::Info b) const { return a.word < b.word; } };
     data.sort();
   }
   void reverse() {
+    Metrics::Timer timer("Words::reverse");
     data.reverse();
   }
 
   void eliminate() {
-    Info* last = &data.back();
-    for(list<Info>::iterator i = data.begin(); i != data.end();) {
+    Metrics::Timer timer("Words::eliminate");
+    const size_t before = data.size();
+    // Only ever points behind i, since removing shifts the values after it
+    Info* last = nullptr;
+    for(unrolledList<Info, poolAllocator>::iterator i = data.begin(); i != data.end();) {
       bool elim = false;
       const std::string& word = i->word;
 
@@ -124,7 +645,7 @@ public:
         elim = true;
       } else if(word != StringFunctions::tolower(word)) {
         elim = true;
-      } else if(word == last->word) { // If the word is the same as the last word evaluated
+      } else if(last != nullptr && word == last->word) { // If the word is the same as the last word evaluated
         if(i->freqCount > last->freqCount) { // If the variation of the word is more common
           i->removeQuotations();
           *last = *i; // Replace the pronunciation with the more common one
@@ -140,57 +661,183 @@ public:
         ++i;
       }
     }
+    Metrics::shared().add("words eliminated", before - data.size());
   }
 
+  // Applies the replacements in order. A pattern can be longer than one phoneme.
   void replacePron(const std::vector<Replacement>& replacements) {
+    replacePron(_replacer(replacements));
+  }
+  // Applies the replacement rules of alphabet
+  void replacePron(const PhonemeAlphabet& alphabet) {
+    replacePron(PhonemeReplacer(alphabet));
+  }
+  void replacePron(const PhonemeReplacer& replacer) {
+    Metrics::Timer timer("Words::replacePron");
+    std::string buffer;
+
+    // Each distinct syllable only needs to be replaced once
+    std::vector<int> replaced(SymbolTable::pronunciations().size(), -1);
     for(Info& i : data) {
-      for(std::string& syl : i.pronunciation) {
-        for(const Replacement& r : replacements) {
-          syl = StringFunctions::replace(syl, r.c, r.replacement);
+      for(int& syl : i.pronunciation) {
+        if(replaced[syl] < 0) {
+          replaced[syl] = _replace(syl, replacer, buffer);
         }
+        syl = replaced[syl];
       }
     }
   }
 
   void read() {
-    std::ifstream file(filePath);
+    read(ThreadPool::shared());
+  }
+  // Uses the binary cache next to the file if there is an up to date one
+  void read(ThreadPool& pool) {
+    Metrics::Timer timer("Words::read");
+    if(_readCache()) return;
+    _read(false, pool);
+  }
 
-    if(file.is_open()) {
-      std::string line;
-      int lineNum = 0;
-      bool firstLine = true;
-      data.clear();
-
-      while(std::getline(file, line)) {
-        lineNum++;
-        if(line == "") continue;
-        if(line.length() > 1 && line[0] == '#' && line[1] == '#') continue;
-        if(line[line.length() - 1] == '\r') {
-          line.pop_back();
-        }
-        if(StringFunctions::onlyContains(line, ' ')) continue;
+  // Same result as read() followed by eliminate(), but records that would
+  // be eliminated are never copied out of the file.
+  void readAndEliminate() {
+    readAndEliminate(ThreadPool::shared());
+  }
+  void readAndEliminate(ThreadPool& pool) {
+    Metrics::Timer timer("Words::readAndEliminate");
+    _read(true, pool);
+  }
+
+  // Same result as readAndEliminate() followed by replacePron(), in a single
+  // pass over the file. While reading, it also adds up how often each
+  // syllable is used by the words kept, for Syllables::importCounts().
+  // Only the words kept are held in memory, never the whole file.
+  void readAndCurate(const std::vector<Replacement>& replacements, std::vector<int>& sylCounts) {
+    readAndCurate(_replacer(replacements), sylCounts, ThreadPool::shared());
+  }
+  void readAndCurate(const std::vector<Replacement>& replacements, std::vector<int>& sylCounts, ThreadPool& pool) {
+    readAndCurate(_replacer(replacements), sylCounts, pool);
+  }
+  void readAndCurate(const PhonemeAlphabet& alphabet, std::vector<int>& sylCounts) {
+    readAndCurate(PhonemeReplacer(alphabet), sylCounts, ThreadPool::shared());
+  }
+  void readAndCurate(const PhonemeAlphabet& alphabet, std::vector<int>& sylCounts, ThreadPool& pool) {
+    readAndCurate(PhonemeReplacer(alphabet), sylCounts, pool);
+  }
+  void readAndCurate(const PhonemeReplacer& replacer, std::vector<int>& sylCounts, ThreadPool& pool) {
+    Metrics::Timer timer("Words::readAndCurate");
+    _read(true, pool, &replacer, &sylCounts);
+  }
+
+  /* Applies a file of changes to the source data to words curated by
+     readAndCurate() and then sorted and reversed, or read back from where
+     they were written. Each record of the file is a record of the source
+     with + or - in front of the word, like the lines of a diff: + adds it
+     and - removes it, so a changed record is one of each. Records go through
+     the same filter and replacements as readAndCurate(), and a word that is
+     already there is only replaced by a more common variation of it. The
+     other variations of a removed word aren't known, so none of them takes
+     its place; if that matters, read the whole source again.
+     changes is set to the words whose record changed, for
+     Syllables::applyDelta(). Each word of the file is found with a binary
+     search on the indexed list, so this takes O(delta log^2 words). */
+  void applyDelta(const std::string& path, const PhonemeAlphabet& alphabet, std::vector<Change>& changes) {
+    applyDelta(path, PhonemeReplacer(alphabet), changes);
+  }
+  void applyDelta(const std::string& path, const PhonemeReplacer& replacer, std::vector<Change>& changes) {
+    Metrics::Timer timer("Words::applyDelta");
+    MappedFile file(path);
+    if(!file.isOpen()) {
+      throw std::invalid_argument("File path not valid.");
+    }
+    Metrics::shared().add("bytes read", file.size());
 
-        if(firstLine) {
-          firstLine = false;
-          continue;
+    std::unordered_map<int, int> replaced; // Pronunciation IDs before and after replacing
+    std::string buffer;
+    auto curate = [&](Info& word) {
+      word.removeQuotations();
+      for(int& syl : word.pronunciation) {
+        auto it = replaced.find(syl);
+        if(it == replaced.end()) {
+          it = replaced.emplace(syl, _replace(syl, replacer, buffer)).first;
         }
-        
-        std::vector<std::string> segments = StringFunctions::split(line, deliminator);
+        syl = it->second;
+      }
+    };
+
+    class Record {
+    public:
+      bool add;
+      Info word;
 
-        if(segments.size() != 4) throw std::runtime_error("Wrong number of segments in line " + std::to_string(lineNum) + ". Segments found: " + std::to_string(segments.size()));
-        if(!StringFunctions::isInteger(segments[1])) throw std::runtime_error("Second segment of line " + std::to_string(lineNum) + " is not an integer.");
-        Info info = Info(segments[0], segments[1], segments[2], segments[3]);
+      Record(const bool& add, Info word) : add(add), word(std::move(word)) {}
+    };
 
-        data.add(info);
+    std::vector<Record> records;
+    RecordReader reader(file.view());
+    std::vector<std::string_view> segments;
+    while(reader.next(segments, 4)) {
+      const bool add = segments[0].length() > 0 && segments[0][0] == '+';
+      if(!add && (segments[0].length() == 0 || segments[0][0] != '-')) {
+        throw std::runtime_error("Word on line " + std::to_string(reader.line()) + " doesn't start with + or -.");
       }
 
-      file.close();
-    } else {
-      throw std::invalid_argument("File path not valid.");
+      const std::string_view word = segments[0].substr(1);
+      const int freqCount = StringFunctions::toInteger(segments[1]);
+      if(freqCount == 0) continue;
+      if(!StringFunctions::onlyAlphabetical(word)) continue;
+      if(!StringFunctions::isLowercase(word)) continue;
+
+      records.emplace_back(add, Info(word, segments[1], segments[2], segments[3]));
+      curate(records.back().word);
+    }
+
+    // Grouped by word, keeping the records of each word in file order
+    std::stable_sort(records.begin(), records.end(), [](const Record& a, const Record& b) { return b.word < a.word; });
+
+    data.setIndexed(true);
+    changes.clear();
+    for(size_t r = 0; r < records.size();) {
+      const std::string word = records[r].word.word;
+      const size_t at = position(word);
+      const bool found = at < data.size() && data[at].word == word;
+      const Info before = found ? data[at] : Info(word, 0, {}, {});
+
+      bool present = found;
+      Info current = before;
+      for(; r < records.size() && records[r].word.word == word; ++r) {
+        const Info& record = records[r].word;
+        if(records[r].add) {
+          if(!present || record.freqCount > current.freqCount) { // Keep the more common variation of the word
+            current = record;
+            present = true;
+          }
+        } else if(present) {
+          // Only the variation that was kept can be removed
+          if(current.freqCount == record.freqCount && current.syllables == record.syllables && current.pronunciation == record.pronunciation) {
+            present = false;
+          }
+        }
+      }
+      if(!present) {
+        current = Info(word, 0, {}, {});
+      }
+
+      if(current.freqCount == before.freqCount && current.syllables == before.syllables && current.pronunciation == before.pronunciation) continue;
+      if(!found) {
+        data.insert(at, current);
+      } else if(!present) {
+        data.remove(at);
+      } else {
+        data[at] = current;
+      }
+      changes.emplace_back(before, std::move(current));
     }
   }
 
-  void write() const {
+  // If cache is set, a binary copy that read() can load quickly is written next to the file
+  void write(const bool& cache = false) const {
+    Metrics::Timer timer("Words::write");
     std::ofstream file(filePath);
     if(file.is_open()) {
       file << "## This file was generated by code using data from another file." << std::endl;
@@ -198,13 +845,19 @@ public:
       file << "Word\\Cob\\WordSyl\\PhonSylCLX" << std::endl;
 
       for(const Info& i : data) {
-        file << i.toString(deliminator) << std::endl;
+        file << i.toString(deliminator) << '\n';
       }
 
+      Metrics::shared().add("bytes written", (int64_t)file.tellp());
+      Metrics::shared().add("records written", (int64_t)data.size());
       file.close();
     } else {
       throw std::invalid_argument("File path not valid.");
     }
+
+    if(cache) {
+      _writeCache();
+    }
   }
 };
 
@@ -213,26 +866,187 @@ class Syllables {
 public:
   class Info {
   public:
-    std::string pronunciation;
+    int id; // In SymbolTable::pronunciations()
     int freqCount;
 
-    Info(const std::string& pronunciation, const int& freqCount) : pronunciation(pronunciation), freqCount(freqCount) {}
+    Info(const int& id, const int& freqCount) : id(id), freqCount(freqCount) {}
 
-    Info(const std::string& pronSeg, const std::string& freqSeg) {
-      pronunciation = pronSeg;
+    Info(std::string_view pronSeg, std::string_view freqSeg) : id(SymbolTable::pronunciations().intern(pronSeg)) {
       if(!StringFunctions::isInteger(freqSeg)) throw std::invalid_argument("freqSeg argument of Info is not an integer.");
-      freqCount = std::stoi(freqSeg);
+      freqCount = StringFunctions::toInteger(freqSeg);
     }
 
+    const std::string& pronunciation() const { return SymbolTable::pronunciations().name(id); }
+
     std::string toString(const char& delim) const {
-      return (pronunciation + delim + std::to_string(freqCount));
+      return (pronunciation() + delim + std::to_string(freqCount));
+    }
+  };
+
+  // Where a syllable is first used in the curated words: the word, and the
+  // position of the syllable in its pronunciation
+  class FirstUse {
+  public:
+    std::string word;
+    int index; // -1 if it isn't used
+
+    FirstUse() : index(-1) {}
+    FirstUse(const std::string& word, const int& index) : word(word), index(index) {}
+
+    bool operator==(const FirstUse& other) const {
+      return index == other.index && word == other.word;
+    }
+    bool operator!=(const FirstUse& other) const {
+      return !(*this == other);
+    }
+    bool operator<(const FirstUse& other) const {
+      if(word != other.word) {
+        return Words::comesBefore(word, other.word);
+      }
+      return index < other.index;
     }
   };
 
+  // A syllable whose count or place in the list changed
+  class Change {
+  public:
+    int id; // In SymbolTable::pronunciations()
+    int before; // 0 if it wasn't in the list
+    int after; // 0 if it isn't any more
+    FirstUse firstBefore; // With before, gives where it was in the list
+
+    Change(const int& id, const int& before, const int& after, const FirstUse& firstBefore = FirstUse()) : id(id), before(before), after(after), firstBefore(firstBefore) {}
+  };
+
 private:
   std::string filePath;
-  list<Info> data;
-  std::unordered_map<std::string, int> counts;
+  unrolledList<Info, poolAllocator> data;
+  std::vector<int> counts; // Indexed by pronunciation ID
+  std::vector<FirstUse> firsts; // Indexed by pronunciation ID, empty if they aren't known
+
+  /* Cache columns: syllable strings (0, 1) and counts (2), then if they are
+     known the words each syllable is first used in (3, 4) and where in them
+     (5) */
+  static constexpr uint32_t cacheKind = 2;
+
+  void _writeCache() const {
+    std::vector<std::string_view> syllables;
+    std::vector<int32_t> freqs;
+    std::vector<std::string_view> firstWords;
+    std::vector<int32_t> firstIndices;
+    for(const Info& i : data) {
+      syllables.push_back(i.pronunciation());
+      freqs.push_back(i.freqCount);
+      if(!firsts.empty()) {
+        firstWords.push_back(firsts[i.id].word);
+        firstIndices.push_back(firsts[i.id].index);
+      }
+    }
+
+    Columnar::Writer writer(cacheKind, data.size());
+    writer.addStrings(syllables);
+    writer.addInts(freqs);
+    if(!firsts.empty()) {
+      writer.addStrings(firstWords);
+      writer.addInts(firstIndices);
+    }
+    writer.write(Columnar::cachePath(filePath), filePath);
+  }
+
+  // Loads the data from the cache next to the file. Returns false if there isn't a usable one.
+  bool _readCache() {
+    Columnar::Reader cache(Columnar::cachePath(filePath), cacheKind, filePath);
+    if(!cache.isValid()) return false;
+
+    const size_t records = cache.records();
+    Columnar::Strings syllables;
+    const int32_t* freqs;
+    if(!cache.strings(0, syllables) || syllables.size() != records) return false;
+    if(!cache.ints(2, records, freqs)) return false;
+
+    clear();
+    for(size_t i = 0; i < records; ++i) {
+      const Info& info = data.emplace_back(SymbolTable::pronunciations().intern(syllables[i]), freqs[i]);
+      if((size_t)info.id >= counts.size()) {
+        counts.resize(info.id + 1, 0);
+      }
+      counts[info.id] = info.freqCount;
+    }
+
+    Columnar::Strings firstWords;
+    const int32_t* firstIndices;
+    if(cache.strings(3, firstWords) && firstWords.size() == records && cache.ints(5, records, firstIndices)) {
+      firsts.assign(counts.size(), FirstUse());
+      size_t i = 0;
+      for(const Info& info : data) {
+        if(firstIndices[i] < 0) {
+          firsts.clear();
+          break;
+        }
+        firsts[info.id] = FirstUse(std::string(firstWords[i]), firstIndices[i]);
+        ++i;
+      }
+    }
+    Metrics::shared().add("records read", records);
+    return true;
+  }
+
+  // Whether a syllable with count a, first used at firstA, is listed before
+  // one with count b, first used at firstB. Syllables with the same count
+  // are listed the other way around from how they are first used, the way
+  // sort() leaves them.
+  static bool _before(const int& a, const FirstUse& firstA, const int& b, const FirstUse& firstB) {
+    if(a != b) {
+      return a > b;
+    }
+    return firstB < firstA;
+  }
+
+  /* Where syllable id is first used in words, which have the changes in
+     changedFirsts (the first use of each syllable in the changed words).
+     If the word it was first used in didn't change, the only words that can
+     come before it are changed ones. Otherwise the first word using it that
+     didn't change is found in the words that used it when they were read,
+     or if that isn't known, by looking through the words from there. */
+  FirstUse _firstUse(const int& id, const Words& words, const std::unordered_set<std::string>& changedWords, const std::unordered_map<int, FirstUse>& changedFirsts) const {
+    const FirstUse& old = firsts[id];
+    const bool moved = old.index >= 0 && changedWords.count(old.word) > 0;
+
+    FirstUse result;
+    if(old.index >= 0 && !moved) {
+      result = old;
+    }
+    const auto changed = changedFirsts.find(id);
+    if(changed != changedFirsts.end() && (result.index < 0 || changed->second < result)) {
+      result = changed->second;
+    }
+
+    if(!moved) return result;
+
+    const bool listed = words.forEachUserWhenRead(id, [&](std::string_view word) {
+      if(result.index >= 0 && !Words::comesBefore(word, result.word)) return false;
+      if(changedWords.count(std::string(word)) > 0) return true;
+
+      const std::vector<int>& pron = words.getData()[words.position(word)].pronunciation;
+      result = FirstUse(std::string(word), (int)(std::find(pron.begin(), pron.end(), id) - pron.begin()));
+      return false;
+    });
+
+    const size_t from = listed ? words.size() : words.position(old.word);
+    if(from < (size_t)words.size()) {
+      for(unrolledList<Words::Info, poolAllocator>::const_iterator i = words.getData().begin() + from; i != words.getData().end(); ++i) {
+        if(result.index >= 0 && !Words::comesBefore(i->word, result.word)) break;
+
+        const std::vector<int>& pron = i->pronunciation;
+        const auto syl = std::find(pron.begin(), pron.end(), id);
+        if(syl != pron.end()) {
+          result = FirstUse(i->word, (int)(syl - pron.begin()));
+          break;
+        }
+      }
+    }
+    return result;
+  }
 
 public:
   Syllables() : filePath("Syllables.txt") {}
@@ -243,97 +1057,269 @@ public:
   void clear() {
     data.clear();
     counts.clear();
+    firsts.clear();
   }
 
   std::string getPath() const { return filePath; }
   void setPath(const std::string& path) { filePath = path; }
 
   int size() const { return data.size(); }
-  const list<Info>& getData() const { return data; }
+  const unrolledList<Info, poolAllocator>& getData() const { return data; }
   const Info& getInfoAt(const int& i) const { return data.at(i); }
+  // For callers that look records up by position, which then takes O(log n)
+  void setIndexed(const bool& enable) { data.setIndexed(enable); }
+  int getSylFreq(const int& id) const {
+    if(id < 0 || (size_t)id >= counts.size()) return 0;
+    return counts[id];
+  }
   int getSylFreq(const std::string& syl) const {
-    auto it = counts.find(syl);
-    if(it == counts.end()) return 0;
-    return it->second;
+    return getSylFreq(SymbolTable::pronunciations().find(syl));
+  }
+
+  // Whether syllables a and b, which must be in the list, are listed in that
+  // order. Needs where each is first used (see applyDelta()).
+  bool comesBefore(const int& a, const int& b) const {
+    return _before(counts[a], firsts[a], counts[b], firsts[b]);
+  }
+  // Where a syllable with this count and first use is in the list, or would
+  // be. Takes O(log^2 n) once the list is indexed.
+  size_t position(const int& freqCount, const FirstUse& first) const {
+    size_t low = 0;
+    size_t high = data.size();
+    while(low < high) {
+      const size_t mid = low + (high - low) / 2;
+      const Info& i = data[mid];
+      if(_before(i.freqCount, firsts[i.id], freqCount, first)) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
   }
 
+  // Large word lists are added up in parts on the shared thread pool
   void import(const Words& words) {
+    Metrics::Timer timer("Syllables::import");
+    const std::vector<int> sylCounts = words.getData().reduce(std::vector<int>(SymbolTable::pronunciations().size(), 0),
+      [](std::vector<int>& sylCounts, const Words::Info& i) {
+        for(const int& pron : i.pronunciation) {
+          sylCounts[pron] += i.freqCount;
+        }
+      },
+      [](std::vector<int>& sylCounts, const std::vector<int>& other) {
+        for(size_t i = 0; i < sylCounts.size(); ++i) {
+          sylCounts[i] += other[i];
+        }
+      });
+    importCounts(words, sylCounts);
+  }
+
+  // Same as import(), with the counts already added up by pronunciation ID,
+  // like Words::readAndCurate() does
+  void importCounts(const Words& words, const std::vector<int>& sylCounts) {
+    Metrics::Timer timer("Syllables::importCounts");
     clear();
+    counts = sylCounts;
+    counts.resize(SymbolTable::pronunciations().size(), 0);
 
-    const list<Words::Info>& wordList = words.getData();
-    for(const Words::Info& i : wordList) {
-      for(const std::string& pron : i.pronunciation) {
-        counts[pron] += i.freqCount;
+    // Syllables in the order they first appear, where, and which ones have
+    class FirstSeen {
+    public:
+      std::vector<bool> seen;
+      std::vector<int> order;
+      std::vector<FirstUse> uses; // Matching order
+
+      FirstSeen(const size_t& size) : seen(size, false) {}
+
+      void add(const int& pron, const std::string& word, const int& index) {
+        if(!seen[pron]) {
+          seen[pron] = true;
+          order.push_back(pron);
+          uses.emplace_back(word, index);
+        }
       }
-    }
+    };
 
-    for(const std::pair<std::string, int>& i : counts) {
-      data.add(Info(i.first, i.second));
+    const FirstSeen first = words.getData().reduce(FirstSeen(counts.size()),
+      [](FirstSeen& first, const Words::Info& i) {
+        for(size_t j = 0; j < i.pronunciation.size(); ++j) {
+          first.add(i.pronunciation[j], i.word, (int)j);
+        }
+      },
+      [](FirstSeen& first, const FirstSeen& other) {
+        for(size_t j = 0; j < other.order.size(); ++j) {
+          first.add(other.order[j], other.uses[j].word, other.uses[j].index);
+        }
+      });
+
+    firsts.assign(counts.size(), FirstUse());
+    for(size_t j = 0; j < first.order.size(); ++j) {
+      data.emplace_back(first.order[j], counts[first.order[j]]);
+      firsts[first.order[j]] = first.uses[j];
     }
   }
 
-  void eliminate(const std::string& vowels) {
-    for(list<Info>::iterator i = data.begin(); i != data.end();) {
-      int vowelCount = 0;
-      for(const char& c : i->pronunciation) {
-        if(StringFunctions::contains(vowels, c)) {
-          vowelCount++;
+  /* Updates counts loaded by read() for the words that changed, where words
+     already has the changes (see Words::applyDelta()). The list ends up the
+     way importCounts(), eliminate() and sort() would leave it for words.
+     Only the syllables in the list keep a count, like read() would load
+     them. Returns the syllables whose count or place in the list changed,
+     including the ones added to or dropped from it, by ID.
+     Syllables with the same count are listed by where they are first used,
+     which is kept for each one and written to the cache. Only the syllables
+     of the changed words are taken out of the list and put back in with a
+     binary search. Finding where one is first used again only passes over
+     words when the word it was first used in changed, from that word to
+     the next one using it. Without the first uses, as when the counts were
+     read from the text file, the list is made again from every word. */
+  std::vector<Change> applyDelta(const Words& words, const std::vector<Words::Change>& wordChanges, const PhonemeClassTable& vowels) {
+    Metrics::Timer timer("Syllables::applyDelta");
+    const SymbolTable& table = SymbolTable::pronunciations();
+    counts.resize(table.size(), 0);
+
+    // How much the count of each syllable of the changed words changed, in the order they are found
+    std::unordered_map<int, int> deltas;
+    std::vector<int> touched;
+    auto add = [&](const int& syl, const int& amount) {
+      const auto entry = deltas.emplace(syl, 0);
+      if(entry.second) {
+        touched.push_back(syl);
+      }
+      entry.first->second += amount;
+    };
+    std::unordered_set<std::string> changedWords;
+    std::unordered_map<int, FirstUse> changedFirsts;
+    for(const Words::Change& c : wordChanges) {
+      changedWords.insert(c.before.word);
+      for(const int& syl : c.before.pronunciation) {
+        add(syl, -c.before.freqCount);
+      }
+      for(size_t j = 0; j < c.after.pronunciation.size(); ++j) {
+        const int& syl = c.after.pronunciation[j];
+        add(syl, c.after.freqCount);
+
+        const FirstUse use(c.after.word, (int)j);
+        const auto entry = changedFirsts.emplace(syl, use);
+        if(!entry.second && use < entry.first->second) {
+          entry.first->second = use;
+        }
+      }
+    }
+
+    std::vector<Change> changes;
+    if(firsts.empty()) {
+      const std::vector<int> before = counts;
+      std::vector<int> after = counts;
+      for(const int& syl : touched) {
+        after[syl] += deltas[syl];
+      }
+
+      importCounts(words, after);
+      eliminate(vowels);
+      sort();
+
+      counts.assign(counts.size(), 0);
+      for(const Info& i : data) {
+        counts[i.id] = i.freqCount;
+      }
+
+      // Any syllable in the list can have moved
+      for(size_t id = 0; id < counts.size(); ++id) {
+        if(before[id] != 0 || counts[id] != 0) {
+          changes.emplace_back((int)id, before[id], counts[id]);
         }
       }
+      return changes;
+    }
+
+    firsts.resize(table.size());
+    data.setIndexed(true);
 
-      if(vowelCount != 1) {
+    // Only syllables with one vowel are ever in the list
+    std::vector<int> listed;
+    for(const int& syl : touched) {
+      if(vowels.count(table.name(syl)) == 1) {
+        listed.push_back(syl);
+      }
+    }
+
+    // Taken out where they were before any of them changed, so the list stays in order
+    for(const int& syl : listed) {
+      if(counts[syl] == 0) continue;
+      const size_t at = position(counts[syl], firsts[syl]);
+      if(at >= data.size() || data[at].id != syl) {
+        throw std::logic_error("Syllable isn't where its count and first use put it in the list.");
+      }
+      data.remove(at);
+    }
+
+    for(const int& syl : listed) {
+      const int before = counts[syl];
+      const FirstUse firstBefore = firsts[syl];
+      counts[syl] += deltas[syl];
+      firsts[syl] = counts[syl] > 0 ? _firstUse(syl, words, changedWords, changedFirsts) : FirstUse();
+      if(counts[syl] > 0) {
+        data.insert(position(counts[syl], firsts[syl]), Info(syl, counts[syl]));
+      }
+
+      if(counts[syl] != before || firsts[syl] != firstBefore) {
+        changes.emplace_back(syl, before, counts[syl], firstBefore);
+      }
+    }
+
+    std::sort(changes.begin(), changes.end(), [](const Change& a, const Change& b) { return a.id < b.id; });
+    return changes;
+  }
+
+  // Removes every syllable that doesn't have exactly one vowel
+  void eliminate(const PhonemeClassTable& vowels) {
+    Metrics::Timer timer("Syllables::eliminate");
+    const size_t before = data.size();
+    for(unrolledList<Info, poolAllocator>::iterator i = data.begin(); i != data.end();) {
+      if(vowels.count(i->pronunciation()) != 1) {
         data.remove(i);
       } else {
         ++i;
       }
     }
+    Metrics::shared().add("syllables removed", before - data.size());
   }
 
   void sort() {
-    auto compare = [&](const Info& a, const Info& b) { return a.freqCount > b.freqCount; };
-    data.sort(compare);
+    Metrics::Timer timer("Syllables::sort");
+    data.sortByKey([](const Info& i) { return i.freqCount; }, true);
   }
 
+  // Uses the binary cache next to the file if there is an up to date one
   void read() {
-    std::ifstream file(filePath);
+    Metrics::Timer timer("Syllables::read");
+    if(_readCache()) return;
 
-    if(file.is_open()) {
-      std::string line;
-      int lineNum = 0;
-      bool firstLine = true;
-      data.clear();
-
-      while(std::getline(file, line)) {
-        lineNum++;
-        if(line == "") continue;
-        if(line.length() > 1 && line[0] == '#' && line[1] == '#') continue;
-        if(line[line.length() - 1] == '\r') {
-          line.pop_back();
-        }
-        if(StringFunctions::onlyContains(line, ' ')) continue;
+    MappedFile file(filePath);
 
-        if(firstLine) {
-          firstLine = false;
-          continue;
-        }
-        
-        std::vector<std::string> segments = StringFunctions::split(line, deliminator);
+    if(file.isOpen()) {
+      RecordReader reader(file.view());
+      std::vector<std::string_view> segments;
+      clear();
 
-        if(segments.size() != 2) throw std::runtime_error("Wrong number of segments in line " + std::to_string(lineNum) + ". Segments found: " + std::to_string(segments.size()));
-        if(!StringFunctions::isInteger(segments[1])) throw std::runtime_error("Second segment of line " + std::to_string(lineNum) + " is not an integer.");
-        
-        Info info(segments[0], segments[1]);
-        data.add(info);
-        counts[info.pronunciation] = info.freqCount;
+      while(reader.next(segments, 2)) {
+        const Info& info = data.emplace_back(segments[0], segments[1]);
+        if((size_t)info.id >= counts.size()) {
+          counts.resize(info.id + 1, 0);
+        }
+        counts[info.id] = info.freqCount;
       }
-
-      file.close();
+      Metrics::shared().add("bytes read", file.size());
+      Metrics::shared().add("records read", data.size());
     } else {
       throw std::invalid_argument("File path not valid.");
     }
   }
 
-  void write() const {
+  // If cache is set, a binary copy that read() can load quickly is written next to the file
+  void write(const bool& cache = false) const {
+    Metrics::Timer timer("Syllables::write");
     std::ofstream file(filePath);
     if(file.is_open()) {
       file << "## This file was generated by code using data from another file." << std::endl;
@@ -341,13 +1327,19 @@ public:
       file << "Syllable\\Count" << std::endl;
 
       for(const Info& i : data) {
-        file << i.toString(deliminator) << std::endl;
+        file << i.toString(deliminator) << '\n';
       }
 
+      Metrics::shared().add("bytes written", (int64_t)file.tellp());
+      Metrics::shared().add("records written", (int64_t)data.size());
       file.close();
     } else {
       throw std::invalid_argument("File path not valid.");
     }
+
+    if(cache) {
+      _writeCache();
+    }
   }
 };
 
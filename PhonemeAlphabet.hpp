@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <initializer_list>
+#include <stdexcept>
+
+#include "PhonemeClassTable.hpp"
+
+
+/* Replaces every c in a pronunciation with replacement */
+class PhonemeRule {
+public:
+  char c;
+  std::string_view replacement;
+
+  constexpr PhonemeRule(const char& c, std::string_view replacement) : c(c), replacement(replacement) {}
+};
+
+
+/* The phonemes the analyses work on: the vowels, the consonants, and the
+   rules that map the phonemes of the source data onto them. Built at
+   compile time, it lets analyses size their arrays by the alphabet. It can
+   also be built at run time to try out other alphabets.
+
+   The rules are applied in order, each to the result of the ones before.
+   Since every rule replaces a single phoneme, that is the same as replacing
+   each phoneme by what the whole list turns it into, so only that is kept. */
+class PhonemeAlphabet {
+private:
+  static constexpr size_t maxImage = 8;
+
+  // What each phoneme is replaced by after every rule
+  char images[256][maxImage];
+  unsigned char imageLengths[256];
+
+  constexpr void _clear() {
+    for(size_t c = 0; c < 256; ++c) {
+      images[c][0] = (char)c;
+      imageLengths[c] = 1;
+    }
+  }
+
+public:
+  PhonemeClassTable vowels;
+  PhonemeClassTable consonants;
+
+  constexpr PhonemeAlphabet() : images(), imageLengths(), vowels(), consonants() {
+    _clear();
+  }
+  constexpr PhonemeAlphabet(const PhonemeClassTable& vowels, const PhonemeClassTable& consonants, std::initializer_list<PhonemeRule> rules) : images(), imageLengths(), vowels(vowels), consonants(consonants) {
+    _clear();
+    for(const PhonemeRule& r : rules) {
+      addRule(r.c, r.replacement);
+    }
+  }
+
+  // Applies the rule after the ones already added
+  constexpr void addRule(const char& c, std::string_view replacement) {
+    for(size_t i = 0; i < 256; ++i) {
+      char image[maxImage] = {};
+      size_t length = 0;
+      for(size_t j = 0; j < imageLengths[i]; ++j) {
+        if(images[i][j] == c) {
+          if(length + replacement.length() > maxImage) throw std::length_error("Replacement in PhonemeAlphabet is too long.");
+          for(const char& r : replacement) {
+            image[length++] = r;
+          }
+        } else {
+          if(length == maxImage) throw std::length_error("Replacement in PhonemeAlphabet is too long.");
+          image[length++] = images[i][j];
+        }
+      }
+
+      for(size_t j = 0; j < length; ++j) {
+        images[i][j] = image[j];
+      }
+      imageLengths[i] = (unsigned char)length;
+    }
+  }
+
+  // What c is replaced by after every rule
+  constexpr std::string_view replacement(const char& c) const {
+    const unsigned char u = (unsigned char)c;
+    return std::string_view(images[u], imageLengths[u]);
+  }
+
+  // Lists the vowels, the consonants, and every phoneme a rule changes with
+  // what it turns into, so alphabets that work the same give the same string
+  std::string toString() const {
+    std::string result;
+    result += vowels.phonemes();
+    result += '|';
+    result += consonants.phonemes();
+    for(size_t c = 0; c < 256; ++c) {
+      if(imageLengths[c] == 1 && images[c][0] == (char)c) continue;
+      result += '|';
+      result += (char)c;
+      result += replacement((char)c);
+    }
+    return result;
+  }
+
+  // Applies every rule to str, adding the result to result
+  void replace(std::string_view str, std::string& result) const {
+    for(const char& c : str) {
+      result += replacement(c);
+    }
+  }
+};
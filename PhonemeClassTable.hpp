@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <bitset>
+#include <string_view>
+#include <initializer_list>
+#include <stdexcept>
+
+#ifdef __SSSE3__
+  #include <tmmintrin.h>
+#endif
+
+
+/* Set of phonemes, like the vowels, that tells whether a character is in it
+   with a single load. Can be built at compile time. Whole syllables can be
+   classified at once; with SSSE3 that takes one byte shuffle per 16
+   characters, otherwise one load per character. */
+class PhonemeClassTable {
+private:
+  bool members[256];
+  char order[256]; // The phonemes in the order they were given
+  size_t length;
+  short indices[256]; // Position of each phoneme in order, or -1
+
+  // Bit (c >> 4) of nibbles[c & 15] is set for every member c below 128
+  uint8_t nibbles[16];
+  bool ascii; // Whether every member is below 128, so nibbles covers them all
+
+  constexpr void _add(const char& c) {
+    if(length == 256) throw std::length_error("Too many phonemes in PhonemeClassTable.");
+    const unsigned char u = (unsigned char)c;
+    order[length] = c;
+    indices[u] = (short)length; // A repeated phoneme takes its last position
+    ++length;
+
+    members[u] = true;
+    if(u < 128) {
+      nibbles[u & 15] |= (uint8_t)(1 << (u >> 4));
+    } else {
+      ascii = false;
+    }
+  }
+
+  // Bit i is set if str[i] is a member. str must be at most 64 characters long.
+  uint64_t _mask(std::string_view str) const {
+    uint64_t result = 0;
+#ifdef __SSSE3__
+    if(ascii) {
+      const __m128i table = _mm_loadu_si128((const __m128i*)nibbles);
+      const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0);
+      const __m128i low = _mm_set1_epi8(15);
+
+      for(size_t i = 0; i < str.length(); i += 16) {
+        char block[16] = {};
+        const size_t n = str.length() - i < 16 ? str.length() - i : 16;
+        std::memcpy(block, str.data() + i, n);
+
+        const __m128i v = _mm_loadu_si128((const __m128i*)block);
+        const __m128i rows = _mm_shuffle_epi8(table, _mm_and_si128(v, low));
+        const __m128i columns = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+        const __m128i misses = _mm_cmpeq_epi8(_mm_and_si128(rows, columns), _mm_setzero_si128());
+
+        const uint64_t hits = ~(uint64_t)_mm_movemask_epi8(misses) & ((1u << n) - 1);
+        result |= hits << i;
+      }
+      return result;
+    }
+#endif
+    for(size_t i = 0; i < str.length(); ++i) {
+      if(contains(str[i])) {
+        result |= (uint64_t)1 << i;
+      }
+    }
+    return result;
+  }
+
+  constexpr void _clear() {
+    for(short& i : indices) {
+      i = -1;
+    }
+  }
+
+public:
+  constexpr PhonemeClassTable() : members(), order(), length(0), indices(), nibbles(), ascii(true) {
+    _clear();
+  }
+  constexpr PhonemeClassTable(std::initializer_list<char> phonemes) : members(), order(), length(0), indices(), nibbles(), ascii(true) {
+    _clear();
+    for(const char& c : phonemes) {
+      _add(c);
+    }
+  }
+  constexpr PhonemeClassTable(std::string_view phonemes) : members(), order(), length(0), indices(), nibbles(), ascii(true) {
+    _clear();
+    for(const char& c : phonemes) {
+      _add(c);
+    }
+  }
+
+  constexpr bool contains(const char& c) const { return members[(unsigned char)c]; }
+
+  // The phonemes in the order they were given, for listing results
+  constexpr std::string_view phonemes() const { return std::string_view(order, length); }
+  constexpr size_t size() const { return length; }
+
+  // Dense index of c, below size(), or -1 if it isn't a member
+  constexpr int index(const char& c) const { return indices[(unsigned char)c]; }
+
+  // Bit i is set if str[i] is a member. Only the first 64 characters are classified.
+  uint64_t mask(std::string_view str) const {
+    return _mask(str.substr(0, 64));
+  }
+
+  // Number of characters in str that are members
+  size_t count(std::string_view str) const {
+    size_t result = 0;
+    for(size_t i = 0; i < str.length(); i += 64) {
+      result += std::bitset<64>(_mask(str.substr(i, 64))).count();
+    }
+    return result;
+  }
+};
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+
+#include "PhonemeAlphabet.hpp"
+
+
+/* A list of replacement rules compiled so a pronunciation is rewritten in a
+   single pass, instead of once per rule. The rules are applied in order,
+   each to the result of the ones before, and a rule replaces every match of
+   its pattern, scanning from the left without overlaps.
+
+   Rules are grouped into passes. Within a pass each phoneme has a table
+   entry with what it turns into, and patterns longer than one phoneme are
+   found with a trie. A single phoneme rule always joins the current pass,
+   by rewriting the table and the outputs of the patterns already in it. A
+   longer pattern only joins it if the pass has no single phoneme rules yet,
+   no pattern in it is removed outright, and the pattern shares no phonemes
+   with the patterns or outputs already in it. That keeps the result the
+   same as applying the rules one by one. Otherwise it starts a new pass. */
+class PhonemeReplacer {
+private:
+  class Pass {
+  private:
+    class Node {
+    public:
+      int next[256]; // 0 if there is no edge, since nothing leads back to the root
+      int rule; // Index of the pattern that ends here, or -1
+
+      Node() : next(), rule(-1) {}
+    };
+
+    std::string images[256]; // What each phoneme turns into
+    std::vector<Node> trie;
+    std::vector<std::string> outputs; // What each pattern turns into
+    bool used[256]; // Phonemes in the patterns or outputs of the trie
+    bool mapped; // Whether a single phoneme rule has been added
+    bool removes; // Whether a pattern has an empty output, which joins its neighbours
+
+  public:
+    Pass() : trie(1), used(), mapped(false), removes(false) {
+      for(size_t c = 0; c < 256; ++c) {
+        images[c] = std::string(1, (char)c);
+      }
+    }
+
+    // Applies c -> replacement after everything already in the pass
+    void map(const char& c, std::string_view replacement) {
+      auto rewrite = [&](std::string& str) {
+        std::string result;
+        for(const char& i : str) {
+          if(i == c) {
+            result += replacement;
+          } else {
+            result += i;
+          }
+        }
+        str = result;
+      };
+
+      for(std::string& image : images) {
+        rewrite(image);
+      }
+      for(std::string& output : outputs) {
+        rewrite(output);
+      }
+      mapped = true;
+    }
+
+    // Sets what c turns into, ignoring the rules already in the pass
+    void assign(const char& c, std::string_view image) {
+      images[(unsigned char)c] = std::string(image);
+      mapped = true;
+    }
+
+    bool accepts(std::string_view pattern) const {
+      if(mapped || removes) return false;
+      for(const char& c : pattern) {
+        if(used[(unsigned char)c]) return false;
+      }
+      return true;
+    }
+
+    void add(std::string_view pattern, std::string_view replacement) {
+      int node = 0;
+      for(const char& c : pattern) {
+        const unsigned char u = (unsigned char)c;
+        if(trie[node].next[u] == 0) {
+          trie[node].next[u] = (int)trie.size();
+          trie.emplace_back();
+        }
+        node = trie[node].next[u];
+        used[u] = true;
+      }
+      trie[node].rule = (int)outputs.size();
+      outputs.emplace_back(replacement);
+
+      for(const char& c : replacement) {
+        used[(unsigned char)c] = true;
+      }
+      if(replacement.empty()) {
+        removes = true;
+      }
+    }
+
+    void apply(std::string_view str, std::string& result) const {
+      for(size_t i = 0; i < str.length();) {
+        // Longest pattern starting at i
+        int rule = -1;
+        size_t length = 0;
+        int node = 0;
+        for(size_t j = i; j < str.length(); ++j) {
+          node = trie[node].next[(unsigned char)str[j]];
+          if(node == 0) break;
+          if(trie[node].rule >= 0) {
+            rule = trie[node].rule;
+            length = j - i + 1;
+          }
+        }
+
+        if(rule >= 0) {
+          result += outputs[rule];
+          i += length;
+        } else {
+          result += images[(unsigned char)str[i]];
+          ++i;
+        }
+      }
+    }
+  };
+
+  std::vector<Pass> passes;
+
+public:
+  PhonemeReplacer() {}
+  // Uses the replacement rules of alphabet
+  PhonemeReplacer(const PhonemeAlphabet& alphabet) : passes(1) {
+    for(size_t c = 0; c < 256; ++c) {
+      passes.back().assign((char)c, alphabet.replacement((char)c));
+    }
+  }
+
+  // Applies the rule after the ones already added
+  void addRule(std::string_view pattern, std::string_view replacement) {
+    if(pattern.empty()) throw std::invalid_argument("Replacement pattern is empty.");
+
+    if(pattern.length() == 1) {
+      if(passes.empty()) {
+        passes.emplace_back();
+      }
+      passes.back().map(pattern[0], replacement);
+    } else {
+      if(passes.empty() || !passes.back().accepts(pattern)) {
+        passes.emplace_back();
+      }
+      passes.back().add(pattern, replacement);
+    }
+  }
+
+  // Sets result to str with every rule applied. str must not point into result.
+  void apply(std::string_view str, std::string& result) const {
+    result.clear();
+    if(passes.empty()) {
+      result += str;
+      return;
+    }
+
+    // Passes alternate between the two buffers so the last one ends in result
+    thread_local std::string other;
+    for(size_t i = 0; i < passes.size(); ++i) {
+      std::string& out = (passes.size() - i) % 2 == 1 ? result : other;
+      out.clear();
+      passes[i].apply(str, out);
+      str = out;
+    }
+  }
+};
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/* Order statistic tree over the entries of a list, like the blocks of an
+   unrolledList or the nodes of a list, for finding the entry that holds a
+   position in O(log n). It is a treap ordered by position: each entry
+   carries its own links, a random priority and the total weight of its
+   subtree, where Weight::of(entry) is how many values the entry holds.
+   Every change updates the totals on its way to the root, so lookups only
+   read and can run on several threads at once.
+
+   Entry needs the members up, left and right (Entry*), total (size_t),
+   priority (uint32_t) and next, the entry after it in the list. Entries
+   that aren't in an index have a priority of 0. */
+template<typename Entry, typename Weight> class PositionIndex {
+private:
+  Entry* root;
+  uint32_t state; // Of the xorshift generator for priorities, never 0
+
+  uint32_t _priority() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  static size_t _total(const Entry* e) { return e == nullptr ? 0 : e->total; }
+
+  static void _pull(Entry* e) {
+    e->total = Weight::of(e) + _total(e->left) + _total(e->right);
+  }
+
+  // Puts other where child is under parent, or at the root
+  void _replace(Entry* parent, Entry* child, Entry* other) {
+    if(parent == nullptr) {
+      root = other;
+    } else if(parent->left == child) {
+      parent->left = other;
+    } else {
+      parent->right = other;
+    }
+    if(other != nullptr) {
+      other->up = parent;
+    }
+  }
+
+  // Lifts e above its parent, keeping the order of the entries
+  void _rotateUp(Entry* e) {
+    Entry* p = e->up;
+    _replace(p->up, p, e);
+    if(p->left == e) {
+      p->left = e->right;
+      if(p->left != nullptr) p->left->up = p;
+      e->right = p;
+    } else {
+      p->right = e->left;
+      if(p->right != nullptr) p->right->up = p;
+      e->left = p;
+    }
+    p->up = e;
+    _pull(p);
+    _pull(e);
+  }
+
+public:
+  PositionIndex() : root(nullptr), state(2463534242u) {}
+
+  // Forgets the entries without touching them, for when they are freed
+  void clear() { root = nullptr; }
+
+  // Indexes the entries from first on, in the order of their next links, in O(n)
+  void build(Entry* first) {
+    root = nullptr;
+    std::vector<Entry*> spine; // Right edge of the tree so far, from the root down
+    for(Entry* e = first; e != nullptr; e = e->next) {
+      e->priority = _priority();
+      e->up = nullptr;
+      e->right = nullptr;
+
+      // Entries lifted out of the spine are complete, so their totals are final
+      Entry* below = nullptr;
+      while(!spine.empty() && spine.back()->priority < e->priority) {
+        below = spine.back();
+        spine.pop_back();
+        _pull(below);
+      }
+      e->left = below;
+      if(below != nullptr) below->up = e;
+      if(!spine.empty()) {
+        spine.back()->right = e;
+        e->up = spine.back();
+      }
+      spine.push_back(e);
+    }
+
+    if(!spine.empty()) root = spine.front();
+    while(!spine.empty()) {
+      _pull(spine.back());
+      spine.pop_back();
+    }
+  }
+
+  // Marks the entries from first on as not indexed and forgets them
+  void drop(Entry* first) {
+    for(Entry* e = first; e != nullptr; e = e->next) {
+      e->up = nullptr;
+      e->left = nullptr;
+      e->right = nullptr;
+      e->priority = 0;
+    }
+    root = nullptr;
+  }
+
+  // Adds e to the index right after prev, or first if prev is null
+  void insertAfter(Entry* prev, Entry* e) {
+    e->left = nullptr;
+    e->right = nullptr;
+    e->priority = _priority();
+    e->total = Weight::of(e);
+    if(root == nullptr) {
+      e->up = nullptr;
+      root = e;
+      return;
+    }
+
+    Entry* parent;
+    if(prev != nullptr && prev->right == nullptr) {
+      parent = prev;
+      parent->right = e;
+    } else {
+      parent = (prev == nullptr) ? root : prev->right;
+      while(parent->left != nullptr) {
+        parent = parent->left;
+      }
+      parent->left = e;
+    }
+    e->up = parent;
+    adjust(parent, e->total);
+
+    while(e->up != nullptr && e->up->priority < e->priority) {
+      _rotateUp(e);
+    }
+  }
+
+  // Takes e out of the index. Its weight must be the one the index last saw.
+  void erase(Entry* e) {
+    while(e->left != nullptr && e->right != nullptr) {
+      _rotateUp(e->left->priority > e->right->priority ? e->left : e->right);
+    }
+    Entry* parent = e->up;
+    _replace(parent, e, e->left != nullptr ? e->left : e->right);
+    adjust(parent, -(ptrdiff_t)Weight::of(e));
+
+    e->up = nullptr;
+    e->left = nullptr;
+    e->right = nullptr;
+    e->priority = 0;
+  }
+
+  // Entry e's weight changed by delta
+  static void adjust(Entry* e, const ptrdiff_t delta) {
+    for(; e != nullptr; e = e->up) {
+      e->total += delta;
+    }
+  }
+
+  static bool contains(const Entry* e) { return e->priority != 0; }
+
+  // Position of the first value of e
+  static size_t rank(const Entry* e) {
+    size_t result = _total(e->left);
+    for(; e->up != nullptr; e = e->up) {
+      if(e->up->right == e) {
+        result += _total(e->up->left) + Weight::of(e->up);
+      }
+    }
+    return result;
+  }
+
+  /* Returns the entry holding the value at position in the tree under top,
+     and sets offset to where it is in the entry. Past the end, returns null
+     with offset 0. */
+  template<typename E>
+  static E* find(E* top, size_t position, size_t& offset) {
+    E* e = top;
+    while(e != nullptr) {
+      const size_t left = _total(e->left);
+      if(position < left) {
+        e = e->left;
+        continue;
+      }
+      position -= left;
+      if(position < Weight::of(e)) {
+        offset = position;
+        return e;
+      }
+      position -= Weight::of(e);
+      e = e->right;
+    }
+    offset = 0;
+    return nullptr;
+  }
+  Entry* find(const size_t position, size_t& offset) const {
+    return find(root, position, offset);
+  }
+
+  // Moves e and offset forward by n values, to null past the end
+  template<typename E>
+  static E* advance(E* e, size_t& offset, const size_t n) {
+    const size_t position = rank(e) + offset + n;
+    while(e->up != nullptr) {
+      e = e->up;
+    }
+    return find(e, position, offset);
+  }
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+#include "ThreadPool.hpp"
+
+
+namespace Reduction {
+  // Below this many elements a reduction runs on the calling thread
+  constexpr size_t parallelThreshold = 1 << 12;
+
+  // Number of parts to split count elements into on pool
+  inline size_t parts(const size_t count, const ThreadPool& pool) {
+    if(count < parallelThreshold) return 1;
+    return pool.size();
+  }
+
+  /* Folds each part with fold(i, result) into its own copy of init, then
+     merges the results from left to right with merge(left, right). If
+     merging gives the same result as folding the right part after the left
+     one, the result doesn't depend on how many parts there are. */
+  template<typename Result, typename Fold, typename Merge>
+  Result combine(const size_t parts, const Result& init, Fold fold, Merge merge, ThreadPool& pool) {
+    std::vector<Result> results(parts, init);
+    pool.run(parts, [&](const size_t i) {
+      fold(i, results[i]);
+    });
+
+    for(size_t i = 1; i < parts; ++i) {
+      merge(results[0], results[i]);
+    }
+    return std::move(results[0]);
+  }
+
+  /* Splits the positions below count into contiguous ranges and folds each
+     with fold(result, begin, end), merging them as above. */
+  template<typename Result, typename Fold, typename Merge>
+  Result reduce(const size_t count, const Result& init, Fold fold, Merge merge, ThreadPool& pool) {
+    const size_t n = parts(count, pool);
+    return combine(n, init, [&](const size_t i, Result& result) {
+      fold(result, count * i / n, count * (i + 1) / n);
+    }, merge, pool);
+  }
+}
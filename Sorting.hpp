@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+
+#include "ThreadPool.hpp"
+
+
+namespace Sorting {
+  // Below this many elements the containers don't bother splitting a sort across threads
+  constexpr size_t parallelThreshold = 1 << 15;
+
+  /* Stable sort split into one run per pool thread, then merged pairwise.
+     Gives the same order as std::stable_sort. */
+  template<typename Value, typename Compare>
+  void stableSort(std::vector<Value>& data, Compare comp, ThreadPool& pool) {
+    size_t runs = pool.size();
+    if(runs <= 1 || data.size() < parallelThreshold) {
+      std::stable_sort(data.begin(), data.end(), comp);
+      return;
+    }
+
+    std::vector<size_t> bounds(runs + 1);
+    for(size_t i = 0; i <= runs; ++i) {
+      bounds[i] = data.size() * i / runs;
+    }
+
+    pool.run(runs, [&](const size_t i) {
+      std::stable_sort(data.begin() + bounds[i], data.begin() + bounds[i + 1], comp);
+    });
+
+    std::vector<Value> buffer(data.size());
+    std::vector<Value>* from = &data;
+    std::vector<Value>* to = &buffer;
+    while(runs > 1) {
+      const size_t pairs = (runs + 1) / 2;
+      pool.run(pairs, [&](const size_t j) {
+        const size_t begin = bounds[2 * j];
+        const size_t middle = bounds[std::min(2 * j + 1, runs)];
+        const size_t end = bounds[std::min(2 * j + 2, runs)];
+        // Equal values from the left run go first, which keeps the merge stable
+        std::merge(from->begin() + begin, from->begin() + middle,
+                   from->begin() + middle, from->begin() + end,
+                   to->begin() + begin, comp);
+      });
+
+      for(size_t j = 0; j < pairs; ++j) {
+        bounds[j] = bounds[2 * j];
+      }
+      bounds[pairs] = data.size();
+      runs = pairs;
+      std::swap(from, to);
+    }
+
+    if(from != &data) {
+      data.swap(buffer);
+    }
+  }
+
+  /* Maps an integer key to an unsigned one that orders the same way, or the
+     opposite way if descending. */
+  template<typename Key>
+  typename std::make_unsigned<Key>::type radixKey(const Key key, const bool& descending) {
+    static_assert(std::is_integral<Key>::value, "Radix sort keys must be integers.");
+    typedef typename std::make_unsigned<Key>::type Unsigned;
+
+    Unsigned result = (Unsigned)key;
+    if(std::is_signed<Key>::value) {
+      result ^= (Unsigned)1 << (sizeof(Unsigned) * 8 - 1);
+    }
+    return descending ? (Unsigned)~result : result;
+  }
+
+  /* Stable LSD radix sort on the first member of each entry, one byte per
+     pass. Passes where every key has the same byte are skipped. */
+  template<typename Unsigned, typename Value>
+  void radixSort(std::vector<std::pair<Unsigned, Value>>& entries) {
+    if(entries.size() < 2) return;
+
+    std::vector<std::pair<Unsigned, Value>> buffer(entries.size());
+    for(size_t shift = 0; shift < sizeof(Unsigned) * 8; shift += 8) {
+      size_t counts[256] = {};
+      for(const std::pair<Unsigned, Value>& e : entries) {
+        counts[(e.first >> shift) & 0xFF]++;
+      }
+      if(counts[(entries[0].first >> shift) & 0xFF] == entries.size()) continue;
+
+      size_t offset = 0;
+      for(size_t& c : counts) {
+        const size_t n = c;
+        c = offset;
+        offset += n;
+      }
+      for(std::pair<Unsigned, Value>& e : entries) {
+        buffer[counts[(e.first >> shift) & 0xFF]++] = std::move(e);
+      }
+      entries.swap(buffer);
+    }
+  }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+#include "MappedFile.hpp"
+
+
+/* Records what each output file of a stage was made from, so a stage whose
+   inputs and configuration haven't changed can be skipped. Next to every
+   output file, "<file>.hash" holds the key of the stage that wrote it and a
+   hash of what it wrote. The output is up to date if the stage's key is the
+   same and the file still has that content. The hashes only need to notice
+   changes, not stand up to anyone making collisions on purpose. */
+namespace StageCache {
+  // Hashes a sequence of strings and numbers eight bytes at a time
+  class Hasher {
+  private:
+    uint64_t state;
+
+    static uint64_t _mix(uint64_t x) {
+      x ^= x >> 33;
+      x *= 0xff51afd7ed558ccdull;
+      x ^= x >> 33;
+      x *= 0xc4ceb9fe1a85ec53ull;
+      x ^= x >> 33;
+      return x;
+    }
+
+    void _word(const uint64_t& w) {
+      state = ((state << 5 | state >> 59) ^ w) * 0x9e3779b97f4a7c15ull;
+    }
+
+  public:
+    Hasher() : state(0x243f6a8885a308d3ull) {}
+
+    void add(const uint64_t& value) {
+      _word(value);
+    }
+
+    // The length goes in too, so "ab", "c" hashes differently from "a", "bc"
+    void add(std::string_view str) {
+      const char* p = str.data();
+      size_t left = str.length();
+      for(; left >= 8; p += 8, left -= 8) {
+        uint64_t w;
+        std::memcpy(&w, p, 8);
+        _word(w);
+      }
+      uint64_t w = 0;
+      std::memcpy(&w, p, left);
+      _word(w);
+      _word(str.length());
+    }
+
+    uint64_t value() const { return _mix(state); }
+  };
+
+  // Returned for a file that can't be read, which no contents hash to on purpose
+  constexpr uint64_t missing = 0;
+
+  uint64_t hashFile(const std::string& path) {
+    MappedFile file(path);
+    if(!file.isOpen()) return missing;
+
+    Hasher hasher;
+    hasher.add(file.view());
+    const uint64_t result = hasher.value();
+    return result == missing ? 1 : result;
+  }
+
+  std::string recordPath(const std::string& path) {
+    return path + ".hash";
+  }
+
+  // Whether the file at path was written by a stage with this key and
+  // hasn't been changed since
+  bool isCurrent(const std::string& path, const uint64_t& key) {
+    std::ifstream record(recordPath(path));
+    uint64_t recordedKey;
+    uint64_t recordedHash;
+    if(!(record >> std::hex >> recordedKey >> recordedHash)) return false;
+
+    return recordedKey == key && recordedHash == hashFile(path);
+  }
+
+  // Notes that the file at path was just written by a stage with this key
+  bool record(const std::string& path, const uint64_t& key) {
+    const uint64_t hash = hashFile(path);
+    if(hash == missing) return false;
+
+    std::ofstream record(recordPath(path), std::ios::trunc);
+    record << std::hex << key << ' ' << hash << '\n';
+    return (bool)record;
+  }
+
+  // Forgets what the file at path was made from, before a stage rewrites it
+  void forget(const std::string& path) {
+    std::error_code error;
+    std::filesystem::remove(recordPath(path), error);
+  }
+}
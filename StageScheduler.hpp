@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <mutex>
+#include <future>
+#include <exception>
+#include <stdexcept>
+#include <filesystem>
+
+#include "ThreadPool.hpp"
+#include "StageCache.hpp"
+#include "Metrics.hpp"
+
+
+/* Runs stages that each read some inputs and write some outputs, named by
+   data file or by the object they fill in. A stage waits for every stage
+   that writes one of its inputs; inputs no stage writes must already exist.
+   Stages that don't depend on each other run at the same time.
+
+   With caching on, a stage is skipped if what it would write is already up
+   to date (see StageCache). Names with an extension are files, the rest
+   objects in memory. A stage's key hashes its name, its configuration,
+   formatVersion, and each input: by the key of the stage writing it, or by
+   its contents if no stage does. Rebuilding the program alone doesn't
+   change a key, so a stage whose code changes what it writes needs a new
+   configuration, or formatVersion a bump if every stage is affected. Only stages writing nothing but files are
+   cached, and not ones that update an input in place. A stage writing only
+   objects runs only if some stage reading them runs. */
+class StageScheduler {
+public:
+  class Stage {
+  public:
+    std::string name;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    std::function<void()> body;
+    std::string config; // Everything besides the inputs that changes what it writes, with a version for its code
+    bool upToDate; // Whether it was skipped since its outputs were up to date
+
+    Stage(const std::string& name, const std::vector<std::string>& inputs, const std::vector<std::string>& outputs, const std::function<void()>& body, const std::string& config) : name(name), inputs(inputs), outputs(outputs), body(body), config(config), upToDate(false) {}
+  };
+
+private:
+  std::vector<Stage> stages;
+  bool caching;
+
+  static bool _isFile(const std::string& name) {
+    return std::filesystem::path(name).has_extension();
+  }
+
+  // dependents[i] holds the stages that read an output of stage i, and
+  // order lists the stages so each comes after the ones it reads from
+  void _link(std::vector<std::vector<size_t>>& dependents, std::vector<size_t>& waiting, std::vector<size_t>& order) const {
+    dependents.assign(stages.size(), std::vector<size_t>());
+    waiting.assign(stages.size(), 0);
+
+    for(size_t i = 0; i < stages.size(); ++i) {
+      for(size_t j = 0; j < stages.size(); ++j) {
+        if(i == j) continue;
+
+        bool reads = false;
+        for(const std::string& input : stages[i].inputs) {
+          if(std::find(stages[j].outputs.begin(), stages[j].outputs.end(), input) != stages[j].outputs.end()) {
+            reads = true;
+          }
+        }
+        if(reads) {
+          dependents[j].push_back(i);
+          ++waiting[i];
+        }
+      }
+    }
+
+    // Every stage must be reachable by finishing the ones before it
+    std::vector<size_t> remaining = waiting;
+    std::vector<size_t> ready;
+    for(size_t i = 0; i < stages.size(); ++i) {
+      if(remaining[i] == 0) ready.push_back(i);
+    }
+    order.clear();
+    while(!ready.empty()) {
+      const size_t i = ready.back();
+      ready.pop_back();
+      order.push_back(i);
+      for(const size_t& d : dependents[i]) {
+        if(--remaining[d] == 0) ready.push_back(d);
+      }
+    }
+    if(order.size() != stages.size()) {
+      throw std::logic_error("Stages depend on each other in a cycle.");
+    }
+  }
+
+  // Finds each stage's key, and marks the stages that don't need to run
+  void _plan(const std::vector<std::vector<size_t>>& dependents, const std::vector<size_t>& order, std::vector<uint64_t>& keys) {
+    keys.assign(stages.size(), 0);
+
+    for(const size_t& i : order) {
+      StageCache::Hasher hasher;
+      hasher.add(stages[i].name);
+      hasher.add(stages[i].config);
+      hasher.add(formatVersion);
+      for(const std::string& input : stages[i].inputs) {
+        hasher.add(input);
+
+        bool written = false;
+        for(size_t j = 0; j < stages.size(); ++j) {
+          if(j == i) continue;
+          if(std::find(stages[j].outputs.begin(), stages[j].outputs.end(), input) != stages[j].outputs.end()) {
+            hasher.add(keys[j]);
+            written = true;
+          }
+        }
+        if(!written && _isFile(input)) {
+          hasher.add(StageCache::hashFile(input));
+        }
+      }
+      keys[i] = hasher.value();
+    }
+
+    // Backwards, so the stages reading from one are decided before it
+    for(size_t k = order.size(); k-- > 0;) {
+      Stage& stage = stages[order[k]];
+      size_t files = 0;
+      bool updates = false;
+      for(const std::string& output : stage.outputs) {
+        if(_isFile(output)) ++files;
+        if(std::find(stage.inputs.begin(), stage.inputs.end(), output) != stage.inputs.end()) updates = true;
+      }
+
+      stage.upToDate = false;
+      if(updates) continue;
+
+      if(files == 0 && !stage.outputs.empty()) {
+        stage.upToDate = true;
+        for(const size_t& d : dependents[order[k]]) {
+          if(!stages[d].upToDate) stage.upToDate = false;
+        }
+      } else if(files == stage.outputs.size()) {
+        stage.upToDate = true;
+        for(const std::string& output : stage.outputs) {
+          if(!StageCache::isCurrent(output, keys[order[k]])) stage.upToDate = false;
+        }
+      }
+    }
+  }
+
+public:
+  // Bumped when a change to the program makes every stage write something else
+  static constexpr uint64_t formatVersion = 1;
+
+  StageScheduler() : caching(false) {}
+
+  void add(const std::string& name, const std::vector<std::string>& inputs, const std::vector<std::string>& outputs, const std::function<void()>& body, const std::string& config = "") {
+    stages.emplace_back(name, inputs, outputs, body, config);
+  }
+
+  // Whether run() skips the stages whose outputs are up to date
+  void setCaching(const bool& caching) {
+    this->caching = caching;
+  }
+
+  int size() const { return stages.size(); }
+  const std::vector<Stage>& getStages() const { return stages; }
+
+  // Runs every stage on pool, each as soon as the stages it reads from have
+  // finished. If a stage throws, the stages depending on it are skipped,
+  // the others still run, and the exception from the earliest stage added
+  // is rethrown at the end.
+  void run(ThreadPool& pool) {
+    std::vector<std::vector<size_t>> dependents;
+    std::vector<size_t> waiting;
+    std::vector<size_t> order;
+    _link(dependents, waiting, order);
+
+    std::vector<uint64_t> keys;
+    if(caching) {
+      _plan(dependents, order, keys);
+      for(const Stage& stage : stages) {
+        if(stage.upToDate) Metrics::shared().add("stages up to date", 1);
+      }
+    } else {
+      for(Stage& stage : stages) {
+        stage.upToDate = false;
+      }
+    }
+
+    // Each stage is timed under the span running here, whichever thread runs it
+    const size_t parent = Metrics::running();
+    std::vector<std::exception_ptr> errors(stages.size());
+    std::vector<bool> skipped(stages.size(), false);
+    std::deque<std::future<void>> pending; // Every stage submitted so far
+    std::mutex mutex;
+
+    std::function<void(const size_t)> start = [&](const size_t i) {
+      std::future<void> f = pool.submit([&, i]() {
+        bool skip;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          skip = skipped[i];
+        }
+
+        if(!skip && !stages[i].upToDate) {
+          Metrics::Timer timer(stages[i].name, parent);
+          try {
+            // Forgotten first, so outputs left half written aren't up to date
+            if(caching) {
+              for(const std::string& output : stages[i].outputs) {
+                if(_isFile(output)) StageCache::forget(output);
+              }
+            }
+
+            stages[i].body();
+
+            if(caching) {
+              for(const std::string& output : stages[i].outputs) {
+                if(_isFile(output)) StageCache::record(output, keys[i]);
+              }
+            }
+          } catch(...) {
+            errors[i] = std::current_exception();
+          }
+        }
+
+        // Started outside the lock, since a pool without workers runs them right away
+        std::vector<size_t> ready;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          for(const size_t& d : dependents[i]) {
+            if(skip || errors[i]) {
+              skipped[d] = true;
+            }
+            if(--waiting[d] == 0) {
+              ready.push_back(d);
+            }
+          }
+        }
+        for(const size_t& d : ready) {
+          start(d);
+        }
+      });
+
+      std::lock_guard<std::mutex> lock(mutex);
+      pending.push_back(std::move(f));
+    };
+
+    // Found before starting any, since a pool without workers runs them right away
+    std::vector<size_t> roots;
+    for(size_t i = 0; i < stages.size(); ++i) {
+      if(waiting[i] == 0) roots.push_back(i);
+    }
+    for(const size_t& i : roots) {
+      start(i);
+    }
+
+    // A stage's dependents are submitted before it finishes, so once every
+    // submitted stage is done, every stage has run
+    for(size_t i = 0;; ++i) {
+      std::future<void>* f;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(i == pending.size()) break;
+        f = &pending[i];
+      }
+      pool.wait(*f);
+    }
+
+    for(const std::exception_ptr& error : errors) {
+      if(error) std::rethrow_exception(error);
+    }
+  }
+};
@@ -2,12 +2,15 @@
 
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <charconv>
+#include <stdexcept>
 
 
 namespace StringFunctions {
   /* Returns true if the string contains character c. */
-  bool contains(const std::string& str, const char& c) {
+  bool contains(std::string_view str, const char& c) {
     for(auto it = str.begin(); it != str.end(); ++it) {
       if(*it == c) {
         return true;
@@ -17,7 +20,7 @@ namespace StringFunctions {
   }
 
   /* Returns true if the string is empty or its only characters are c. */
-  bool onlyContains(const std::string& str, const char& c) {
+  bool onlyContains(std::string_view str, const char& c) {
     for(auto it = str.begin(); it != str.end(); ++it) {
       if(*it != c) {
         return false;
@@ -26,7 +29,7 @@ namespace StringFunctions {
     return true;
   }
 
-  bool onlyAlphabetical(const std::string& str) {
+  bool onlyAlphabetical(std::string_view str) {
     for(auto it = str.begin(); it != str.end(); ++it) {
       if(!std::isalpha(*it)) {
         return false;
@@ -35,6 +38,16 @@ namespace StringFunctions {
     return true;
   }
 
+  /* Returns true if tolower() would leave the string unchanged. */
+  bool isLowercase(std::string_view str) {
+    for(auto it = str.begin(); it != str.end(); ++it) {
+      if(std::tolower(*it) != *it) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   std::string remove(const std::string& str, const char& c) {
     std::string result;
     for(auto it = str.begin(); it != str.end(); ++it) {
@@ -76,7 +89,7 @@ namespace StringFunctions {
     return result;
   }
 
-  bool isInteger(const std::string& str) {
+  bool isInteger(std::string_view str) {
     if(str.length() == 0) return false;
 
     auto it = str.begin();
@@ -94,19 +107,39 @@ namespace StringFunctions {
     return true;
   }
 
-  std::vector<std::string> split(const std::string& str, const char& delim) {
+  /* Parses a string that passes isInteger(). Throws std::out_of_range if it doesn't fit in an int. */
+  int toInteger(std::string_view str) {
+    int result = 0;
+    const std::from_chars_result parsed = std::from_chars(str.data(), str.data() + str.length(), result);
+    if(parsed.ec == std::errc::result_out_of_range) {
+      throw std::out_of_range("toInteger argument does not fit in an int.");
+    }
+    return result;
+  }
+
+  /* Splits str at every delim. The views point into str. */
+  void splitView(std::string_view str, const char& delim, std::vector<std::string_view>& result) {
+    result.clear();
+
+    size_t start = 0;
+    size_t pos;
+    while((pos = str.find(delim, start)) != std::string_view::npos) {
+      result.push_back(str.substr(start, pos - start));
+      start = pos + 1;
+    }
+    result.push_back(str.substr(start));
+  }
+
+  std::vector<std::string> split(std::string_view str, const char& delim) {
     std::vector<std::string> result;
 
-    std::string seg = "";
-    for(auto it = str.begin(); it != str.end(); ++it) {
-      if(*it == delim) {
-        result.push_back(seg);
-        seg = "";
-      } else {
-        seg += *it;
-      }
+    size_t start = 0;
+    size_t pos;
+    while((pos = str.find(delim, start)) != std::string_view::npos) {
+      result.emplace_back(str.substr(start, pos - start));
+      start = pos + 1;
     }
-    result.push_back(seg);
+    result.emplace_back(str.substr(start));
 
     return result;
   }
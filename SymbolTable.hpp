@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+
+
+/* Gives every distinct string a dense integer ID, starting from 0. Each
+   string is stored once and lives as long as the table. Safe to use from
+   several threads at once. */
+class SymbolTable {
+private:
+  // FNV-1a. The strings are a few characters long, where it beats std::hash.
+  struct Hash {
+    size_t operator()(std::string_view str) const {
+      size_t hash = 14695981039346656037ull;
+      for(const char& c : str) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ull;
+      }
+      return hash;
+    }
+  };
+
+  std::deque<std::string> names; // Never moves its elements, so the keys of ids stay valid
+  std::unordered_map<std::string_view, int, Hash> ids;
+  mutable std::shared_mutex mutex;
+
+  // Adds str if it isn't in the table yet. The caller must hold the unique lock.
+  int _insert(std::string_view str) {
+    auto it = ids.find(str);
+    if(it != ids.end()) return it->second;
+
+    const int id = (int)names.size();
+    names.emplace_back(str);
+    ids.emplace(names.back(), id);
+    return id;
+  }
+
+public:
+  SymbolTable() {}
+
+  SymbolTable(const SymbolTable& other) = delete;
+  SymbolTable& operator=(const SymbolTable& other) = delete;
+
+  // Returns the ID of str, adding it if it hasn't been seen before
+  int intern(std::string_view str) {
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      auto it = ids.find(str);
+      if(it != ids.end()) return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return _insert(str); // Another thread may have added it in between
+  }
+
+  // Returns the ID of str, or -1 if it has never been added
+  int find(std::string_view str) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(str);
+    if(it == ids.end()) return -1;
+    return it->second;
+  }
+
+  const std::string& name(const int& id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names[id];
+  }
+
+  // Every ID below size() is in use
+  size_t size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+  }
+
+  // Splits str at every delim and returns the ID of each part. Takes the
+  // lock once for all of them, and again only if some are new.
+  std::vector<int> internAll(std::string_view str, const char& delim) {
+    std::vector<int> result(std::count(str.begin(), str.end(), delim) + 1, -1);
+    bool missing = false;
+
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      size_t start = 0;
+      for(int& id : result) {
+        size_t end = str.find(delim, start);
+        if(end == std::string_view::npos) end = str.length();
+
+        auto it = ids.find(str.substr(start, end - start));
+        if(it != ids.end()) {
+          id = it->second;
+        } else {
+          missing = true;
+        }
+        start = end + 1;
+      }
+    }
+
+    if(missing) {
+      std::unique_lock<std::shared_mutex> lock(mutex);
+      size_t start = 0;
+      for(int& id : result) {
+        size_t end = str.find(delim, start);
+        if(end == std::string_view::npos) end = str.length();
+
+        if(id < 0) {
+          id = _insert(str.substr(start, end - start));
+        }
+        start = end + 1;
+      }
+    }
+
+    return result;
+  }
+
+  // Joins the strings with the given IDs, putting delim between them
+  std::string toString(const std::vector<int>& data, const char& delim) const {
+    std::string result;
+    for(size_t i = 0; i < data.size(); ++i) {
+      if(i > 0) result += delim;
+      result += name(data[i]);
+    }
+    return result;
+  }
+
+  // Written syllables of words, like the "ap" in "ap-ple"
+  static SymbolTable& spellings() {
+    static SymbolTable table;
+    return table;
+  }
+  // Syllables of pronunciations, which the analyses work on
+  static SymbolTable& pronunciations() {
+    static SymbolTable table;
+    return table;
+  }
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <chrono>
+#include <exception>
+
+
+// Fixed set of worker threads. The thread calling run() works alongside
+// them, so a pool of size n starts n - 1 workers, and a pool of size 1
+// runs everything on the calling thread.
+class ThreadPool {
+private:
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable available;
+  bool stopping;
+
+  void _work() {
+    while(true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        available.wait(lock, [&]() { return stopping || !tasks.empty(); });
+        if(tasks.empty()) return;
+
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  // Runs one queued task on the calling thread, if there is one
+  bool _runOne() {
+    std::function<void()> task;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(tasks.empty()) return false;
+
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+    return true;
+  }
+
+public:
+  ThreadPool() : ThreadPool(std::thread::hardware_concurrency()) {}
+  ThreadPool(size_t threads) : stopping(false) {
+    if(threads == 0) threads = 1;
+    for(size_t i = 1; i < threads; ++i) {
+      workers.emplace_back([this]() { _work(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool& other) = delete;
+  ThreadPool& operator=(const ThreadPool& other) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    available.notify_all();
+    for(std::thread& t : workers) {
+      t.join();
+    }
+  }
+
+  // Number of threads that work on run(), including the caller
+  size_t size() const { return workers.size() + 1; }
+
+  // Queues a task for the workers. Runs it immediately if there are none.
+  template<typename Function>
+  std::future<void> submit(Function&& f) {
+    auto task = std::make_shared<std::packaged_task<void()>>(std::forward<Function>(f));
+    std::future<void> result = task->get_future();
+
+    if(workers.empty()) {
+      (*task)();
+      return result;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace_back([task]() { (*task)(); });
+    }
+    available.notify_one();
+    return result;
+  }
+
+  // Waits for a task from submit(), running queued tasks in the meantime
+  void wait(std::future<void>& f) {
+    while(f.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      if(!_runOne()) {
+        f.wait();
+      }
+    }
+  }
+
+  // Calls body(i) for every i below count and waits for all of them.
+  // The first exception thrown by a task is rethrown here. While waiting,
+  // the caller runs queued tasks, so tasks may call run() themselves.
+  template<typename Function>
+  void run(const size_t count, const Function& body) {
+    if(count == 0) return;
+
+    std::vector<std::future<void>> pending;
+    pending.reserve(count - 1);
+    for(size_t i = 1; i < count; ++i) {
+      pending.push_back(submit([&body, i]() { body(i); }));
+    }
+
+    std::exception_ptr error;
+    try {
+      body(0);
+    } catch(...) {
+      error = std::current_exception();
+    }
+
+    for(std::future<void>& f : pending) {
+      wait(f);
+      try {
+        f.get();
+      } catch(...) {
+        if(!error) error = std::current_exception();
+      }
+    }
+
+    if(error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // Pool shared by the containers and parsers, sized to the machine
+  static ThreadPool& shared() {
+    static ThreadPool pool;
+    return pool;
+  }
+};
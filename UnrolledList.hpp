@@ -0,0 +1,873 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <new>
+
+#include "Allocators.hpp"
+#include "ThreadPool.hpp"
+#include "Sorting.hpp"
+#include "Reduction.hpp"
+#include "PositionIndex.hpp"
+
+
+// Linked list of fixed-size blocks that store their values inline. Has the
+// same interface as list<T>, but costs one allocation per block instead of
+// two per element and iterates through contiguous memory. Every block but
+// the last is kept at least about half full. Blocks come from the
+// allocation policy Alloc (see Allocators.hpp).
+template<typename T, template<typename> class Alloc = heapAllocator> class unrolledList {
+private:
+  struct block;
+  struct blockWeight;
+  typedef PositionIndex<block, blockWeight> Index;
+
+  // Blocks are sized to about blockBytes, and never hold fewer than 4 values
+  static constexpr size_t blockBytes = 1024;
+  static constexpr size_t capacity = (blockBytes / sizeof(T) > 4) ? blockBytes / sizeof(T) : 4;
+
+  block* first;
+  block* last;
+  size_t length;
+
+  Alloc<block> blocks;
+
+  // Optional tree over the blocks by position (see PositionIndex.hpp), kept
+  // up to date by every change, so lookups never write to the list
+  bool indexed;
+  Index positions;
+
+  void _deleteBlocks(block* b) {
+    block* nextb;
+    while(b != nullptr) {
+      nextb = b->next;
+      b->destroyValues();
+      blocks.destroy(b);
+      b = nextb;
+    }
+  }
+
+  void _clear() {
+    if(Alloc<block>::bulkRelease) {
+      for(block* b = first; b != nullptr; b = b->next) {
+        b->destroyValues();
+      }
+      blocks.release();
+    } else {
+      _deleteBlocks(first);
+    }
+    first = nullptr;
+    last = nullptr;
+    length = 0;
+    positions.clear();
+  }
+
+  // Moves b and offset forward by a number of elements, skipping whole blocks
+  template<typename Block>
+  static void _incrementBy(Block*& b, size_t& offset, const size_t elements) {
+    offset += elements;
+    while(b != nullptr && offset >= b->count) {
+      offset -= b->count;
+      b = b->next;
+    }
+    if(b == nullptr) {
+      offset = 0;
+    }
+  }
+
+  // Same as _incrementBy, but through the index if b is in one
+  template<typename Block>
+  static void _advance(Block*& b, size_t& offset, const size_t elements) {
+    if(b != nullptr && Index::contains(b)) {
+      b = Index::advance(b, offset, elements);
+    } else {
+      _incrementBy(b, offset, elements);
+    }
+  }
+
+  // Indexes the blocks if the list is indexed, or marks them as not indexed
+  void _reindex() {
+    if(indexed) {
+      positions.build(first);
+    } else {
+      positions.drop(first);
+    }
+  }
+
+  // Sets how many values b holds, keeping the index's totals in step
+  void _setCount(block* const b, const size_t count) {
+    if(indexed) {
+      Index::adjust(b, (ptrdiff_t)count - (ptrdiff_t)b->count);
+    }
+    b->count = count;
+  }
+
+  // Returns the block holding element index and sets offset to its position in that block
+  block* _findBlock(const size_t index, size_t& offset) const {
+    if(indexed) {
+      return positions.find(index, offset);
+    }
+
+    block* b = first;
+    offset = 0;
+    _incrementBy(b, offset, index);
+    return b;
+  }
+
+  block* _findLast() const {
+    size_t offset;
+    return _findBlock(length - 1, offset);
+  }
+
+  block* _newBlockAfter(block* const b) {
+    block* nb = blocks.create();
+    nb->prev = b;
+    if(b == nullptr) {
+      nb->next = first;
+      first = nb;
+    } else {
+      nb->next = b->next;
+      b->next = nb;
+    }
+
+    if(nb->next == nullptr) {
+      last = nb;
+    } else {
+      nb->next->prev = nb;
+    }
+
+    if(indexed) {
+      positions.insertAfter(b, nb);
+    }
+    return nb;
+  }
+
+  void _deleteBlock(block* const b) {
+    if(indexed) {
+      positions.erase(b);
+    }
+    if(b->prev == nullptr) {
+      first = b->next;
+    } else {
+      b->prev->next = b->next;
+    }
+
+    if(b->next == nullptr) {
+      last = b->prev;
+    } else {
+      b->next->prev = b->prev;
+    }
+
+    b->destroyValues();
+    blocks.destroy(b);
+  }
+
+  // Moves the upper half of b into a new block following it
+  void _split(block* const b) {
+    block* nb = _newBlockAfter(b);
+    const size_t half = b->count / 2;
+
+    T* from = b->values();
+    T* to = nb->values();
+    for(size_t i = half; i < b->count; ++i) {
+      new(to + i - half) T(std::move(from[i]));
+      from[i].~T();
+    }
+
+    _setCount(nb, b->count - half);
+    _setCount(b, half);
+  }
+
+  /* Keeps b at least half full after a removal. It takes values from the
+     block after it, or from the one before it if b is the last, and the
+     two are merged if they fit in one block. Otherwise they split their
+     values evenly, so runs of nearly empty blocks can't build up. b and
+     offset stay on the same value of the list, or one past the end of b. */
+  void _rebalance(block*& b, size_t& offset) {
+    if(b->count >= capacity / 2) {
+      return;
+    }
+
+    if(b->next != nullptr) {
+      block* nb = b->next;
+      const size_t moved = (b->count + nb->count <= capacity) ? nb->count : (nb->count - b->count) / 2;
+
+      T* from = nb->values();
+      T* to = b->values();
+      for(size_t i = 0; i < moved; ++i) {
+        new(to + b->count + i) T(std::move(from[i]));
+      }
+      _setCount(b, b->count + moved);
+
+      if(moved == nb->count) {
+        _deleteBlock(nb);
+        return;
+      }
+      for(size_t i = moved; i < nb->count; ++i) {
+        from[i - moved] = std::move(from[i]);
+      }
+      for(size_t i = nb->count - moved; i < nb->count; ++i) {
+        from[i].~T();
+      }
+      _setCount(nb, nb->count - moved);
+    } else if(b->prev != nullptr) {
+      block* pb = b->prev;
+      if(pb->count + b->count <= capacity) {
+        T* from = b->values();
+        T* to = pb->values();
+        for(size_t i = 0; i < b->count; ++i) {
+          new(to + pb->count + i) T(std::move(from[i]));
+        }
+        offset += pb->count;
+        _setCount(pb, pb->count + b->count);
+        _deleteBlock(b);
+        b = pb;
+        return;
+      }
+
+      // Makes room at the front of b, then fills it from the end of pb
+      const size_t moved = (pb->count - b->count) / 2;
+      T* v = b->values();
+      for(size_t i = b->count; i > 0; --i) {
+        if(i - 1 + moved >= b->count) {
+          new(v + i - 1 + moved) T(std::move(v[i - 1]));
+        } else {
+          v[i - 1 + moved] = std::move(v[i - 1]);
+        }
+      }
+      T* from = pb->values() + pb->count - moved;
+      for(size_t i = 0; i < moved; ++i) {
+        if(i < b->count) {
+          v[i] = std::move(from[i]);
+        } else {
+          new(v + i) T(std::move(from[i]));
+        }
+        from[i].~T();
+      }
+      _setCount(pb, pb->count - moved);
+      _setCount(b, b->count + moved);
+      offset += moved;
+    }
+  }
+
+  template<typename... Args>
+  void _emplaceBack(Args&&... args) {
+    if(last == nullptr || last->count == capacity) {
+      _newBlockAfter(last);
+    }
+
+    new(last->values() + last->count) T(std::forward<Args>(args)...);
+    _setCount(last, last->count + 1);
+    length++;
+  }
+
+  void _insert(const size_t index, const T& value) {
+    if(index == length) {
+      _emplaceBack(value);
+      return;
+    }
+
+    size_t offset;
+    block* b = _findBlock(index, offset);
+
+    if(b->count == capacity) {
+      _split(b);
+      if(offset > b->count) {
+        offset -= b->count;
+        b = b->next;
+      }
+    }
+
+    T* v = b->values();
+    if(offset == b->count) {
+      new(v + offset) T(value);
+    } else {
+      new(v + b->count) T(std::move(v[b->count - 1]));
+      for(size_t i = b->count - 1; i > offset; --i) {
+        v[i] = std::move(v[i - 1]);
+      }
+      v[offset] = value;
+    }
+
+    _setCount(b, b->count + 1);
+    length++;
+  }
+
+  void _pop() {
+    if(length == 0) return;
+
+    last->values()[last->count - 1].~T();
+    _setCount(last, last->count - 1);
+    length--;
+
+    if(last->count == 0) {
+      _deleteBlock(last);
+    }
+  }
+
+  // Removes the element at offset in b. Afterwards b and offset refer to the
+  // element that followed it, or are null at the end of the list.
+  void _remove(block*& b, size_t& offset) {
+    T* v = b->values();
+    for(size_t i = offset; i + 1 < b->count; ++i) {
+      v[i] = std::move(v[i + 1]);
+    }
+    v[b->count - 1].~T();
+    _setCount(b, b->count - 1);
+    length--;
+
+    if(b->count == 0) {
+      block* nextb = b->next;
+      _deleteBlock(b);
+      b = nextb;
+      offset = 0;
+      return;
+    }
+
+    _rebalance(b, offset);
+    if(offset == b->count) {
+      b = b->next;
+      offset = 0;
+    }
+  }
+
+  void _resize(const size_t size, const T* const value) {
+    while(length > size) {
+      _pop();
+    }
+
+    if(value == nullptr) {
+      while(length < size) {
+        _emplaceBack();
+      }
+    } else {
+      while(length < size) {
+        _emplaceBack(*value);
+      }
+    }
+  }
+
+  // Moves the values into new, full blocks in the given order. The blocks
+  // are indexed once they are all there.
+  void _reorder(const std::vector<T*>& order) {
+    const bool wasIndexed = indexed;
+    block* oldFirst = first;
+    first = nullptr;
+    last = nullptr;
+    length = 0;
+    indexed = false;
+    positions.clear();
+    for(T* p : order) {
+      _emplaceBack(std::move(*p));
+    }
+    _deleteBlocks(oldFirst);
+    indexed = wasIndexed;
+    if(indexed) {
+      positions.build(first);
+    }
+  }
+
+  // Same as _reorder(), for copying an empty list from other
+  void _copyFrom(const unrolledList& other) {
+    const bool wasIndexed = indexed;
+    indexed = false;
+    for(const block* b = other.first; b != nullptr; b = b->next) {
+      const T* v = b->values();
+      for(size_t i = 0; i < b->count; ++i) {
+        _emplaceBack(v[i]);
+      }
+    }
+    indexed = wasIndexed;
+    if(indexed) {
+      positions.build(first);
+    }
+  }
+
+
+public:
+  class iterator;
+  class const_iterator;
+  class OutOfRange;
+
+  unrolledList() : first(nullptr), last(nullptr), length(0), indexed(false) {}
+
+  /* Deep Copy */
+  unrolledList(const unrolledList& other) : first(nullptr), last(nullptr), length(0), indexed(other.indexed) {
+    _copyFrom(other);
+  }
+
+  /* Takes other's blocks and leaves it empty */
+  unrolledList(unrolledList&& other) : unrolledList() {
+    indexed = other.indexed;
+    other.transferTo(*this);
+  }
+
+  /* Deep Copy */
+  unrolledList& operator=(const unrolledList& other) {
+    if(this == &other) {
+      return *this;
+    }
+
+    _clear();
+    _copyFrom(other);
+    return *this;
+  }
+
+  unrolledList& operator=(unrolledList&& other) {
+    other.transferTo(*this);
+    return *this;
+  }
+
+  ~unrolledList() {
+    _clear();
+  }
+
+  iterator begin() { return iterator(first, 0); }
+  const_iterator begin() const { return const_iterator(first, 0); }
+
+  iterator end() { return nullptr; }
+  const_iterator end() const { return nullptr; }
+
+  size_t size() const { return length; }
+
+  // Keeps an index so operator[], at, insert and remove by position, and
+  // iterator + n, take O(log n). Every change then updates it in O(log n)
+  // as well, so lists that are only appended to and walked are better off
+  // without it. Lookups don't change it, so they can run concurrently.
+  void setIndexed(const bool& enable) {
+    if(enable == indexed) {
+      return;
+    }
+    indexed = enable;
+    _reindex();
+  }
+  bool isIndexed() const { return indexed; }
+
+  T& operator[](const size_t index) {
+    size_t offset;
+    block* b = _findBlock(index, offset);
+    return b->values()[offset];
+  }
+  const T& operator[](const size_t index) const {
+    size_t offset;
+    const block* b = _findBlock(index, offset);
+    return b->values()[offset];
+  }
+
+  T& at(const size_t index) {
+    if(index >= length) {
+      throw OutOfRange(length, index);
+    }
+    return operator[](index);
+  }
+  const T& at(const size_t index) const {
+    if(index >= length) {
+      throw OutOfRange(length, index);
+    }
+    return operator[](index);
+  }
+
+  T& back() { return last->values()[last->count - 1]; }
+  const T& back() const { return last->values()[last->count - 1]; }
+
+  void clear() { _clear(); }
+
+  void resize(const size_t size) { _resize(size, nullptr); }
+  void resize(const size_t size, const T& value) { _resize(size, &value); }
+
+  void add(const T& value) {
+    _emplaceBack(value);
+  }
+  void add(T&& value) {
+    _emplaceBack(std::move(value));
+  }
+
+  // Constructs the new last value in place from args
+  template<typename... Args>
+  T& emplace_back(Args&&... args) {
+    _emplaceBack(std::forward<Args>(args)...);
+    return back();
+  }
+
+  void insert(const size_t index, const T& value) {
+    if(index > length) {
+      throw OutOfRange(length, index);
+    }
+    _insert(index, value);
+  }
+
+  void pop() { _pop(); }
+
+  // Removing an element moves the values after it in the same block, so
+  // references to later elements are invalidated. Earlier ones are not.
+  void remove(const size_t index) {
+    if(index >= length) {
+      throw OutOfRange(length, index);
+    }
+    size_t offset;
+    block* b = _findBlock(index, offset);
+    _remove(b, offset);
+  }
+  void remove(iterator& it) {
+    _remove(it.ptr, it.offset);
+  }
+  void remove(const iterator& it) {
+    iterator copy = it;
+    _remove(copy.ptr, copy.offset);
+  }
+
+  // Overwrites list other with the data in this list, removing the data in this list
+  void transferTo(unrolledList& other) {
+    if(this == &other) {
+      return;
+    }
+
+    other.clear();
+    other.first = first;
+    other.last = last;
+    other.length = length;
+    other.blocks.swap(blocks);
+    other.positions = positions;
+
+    first = nullptr;
+    last = nullptr;
+    length = 0;
+    positions.clear();
+
+    if(other.indexed != indexed) {
+      other._reindex();
+    }
+  }
+
+  // Moves the data in list other to the end of this list without copying it, leaving other empty
+  void splice(unrolledList& other) {
+    if(this == &other || other.length == 0) {
+      return;
+    }
+
+    block* join = last;
+    if(indexed) {
+      block* prev = last;
+      for(block* b = other.first; b != nullptr; b = b->next) {
+        positions.insertAfter(prev, b);
+        prev = b;
+      }
+    } else if(other.indexed) {
+      other.positions.drop(other.first);
+    }
+
+    if(length == 0) {
+      first = other.first;
+    } else {
+      last->next = other.first;
+      other.first->prev = last;
+    }
+    last = other.last;
+    length += other.length;
+    blocks.adopt(other.blocks);
+
+    other.first = nullptr;
+    other.last = nullptr;
+    other.length = 0;
+    other.positions.clear();
+
+    // This list's last block is no longer last
+    if(join != nullptr) {
+      size_t offset = 0;
+      _rebalance(join, offset);
+    }
+  }
+
+  // Reverses the order of the list
+  void reverse() {
+    block* b = first;
+    while(b != nullptr) {
+      std::reverse(b->values(), b->values() + b->count);
+      std::swap(b->prev, b->next);
+      b = b->prev;
+    }
+    std::swap(first, last);
+    if(indexed) {
+      positions.build(first);
+    }
+
+    // The last block, which may be short, is now the first
+    if(first != nullptr) {
+      block* b = first;
+      size_t offset = 0;
+      _rebalance(b, offset);
+    }
+  }
+
+  // Gives the same order as list<T>::sort, which places equal values in the
+  // reverse of their original order, and leaves every block full. Large
+  // lists are sorted on the shared thread pool.
+  template<typename Compare = std::less<>>
+  void sort(Compare comp = Compare()) {
+    sort(comp, ThreadPool::shared());
+  }
+  template<typename Compare>
+  void sort(Compare comp, ThreadPool& pool) {
+    if(length < 2) return;
+
+    std::vector<T*> order;
+    order.reserve(length);
+    for(block* b = last; b != nullptr; b = b->prev) {
+      for(size_t i = b->count; i > 0; --i) {
+        order.push_back(b->values() + i - 1);
+      }
+    }
+
+    Sorting::stableSort(order, [&](const T* a, const T* b) { return comp(*a, *b); }, pool);
+    _reorder(order);
+  }
+
+  // Radix sort on the integer returned by key. Takes linear time and gives
+  // the same order as sort() with the matching comparison, ties included.
+  template<typename KeyFunction>
+  void sortByKey(KeyFunction key, const bool& descending = false) {
+    if(length < 2) return;
+
+    typedef decltype(Sorting::radixKey(key(*first->values()), descending)) Unsigned;
+    std::vector<std::pair<Unsigned, T*>> entries;
+    entries.reserve(length);
+    for(block* b = last; b != nullptr; b = b->prev) {
+      for(size_t i = b->count; i > 0; --i) {
+        T* p = b->values() + i - 1;
+        entries.emplace_back(Sorting::radixKey(key(*p), descending), p);
+      }
+    }
+
+    Sorting::radixSort(entries);
+
+    std::vector<T*> order;
+    order.reserve(length);
+    for(const std::pair<Unsigned, T*>& e : entries) {
+      order.push_back(e.second);
+    }
+    _reorder(order);
+  }
+
+  // Same as list<T>::reduce
+  template<typename Result, typename Add, typename Merge>
+  Result reduce(const Result& init, Add add, Merge merge) const {
+    return reduce(init, add, merge, ThreadPool::shared());
+  }
+  template<typename Result, typename Add, typename Merge>
+  Result reduce(const Result& init, Add add, Merge merge, ThreadPool& pool) const {
+    const size_t parts = Reduction::parts(length, pool);
+    std::vector<const block*> startBlocks(parts);
+    std::vector<size_t> startOffsets(parts);
+    const block* b = first;
+    size_t offset = 0;
+    for(size_t i = 0; i < parts; ++i) {
+      startBlocks[i] = b;
+      startOffsets[i] = offset;
+      _incrementBy(b, offset, length * (i + 1) / parts - length * i / parts);
+    }
+
+    return Reduction::combine(parts, init, [&](const size_t i, Result& result) {
+      const block* q = startBlocks[i];
+      size_t k = startOffsets[i];
+      size_t remaining = length * (i + 1) / parts - length * i / parts;
+      while(remaining > 0) {
+        const size_t n = std::min(remaining, q->count - k);
+        const T* v = q->values();
+        for(size_t j = k; j < k + n; ++j) {
+          add(result, v[j]);
+        }
+        remaining -= n;
+        q = q->next;
+        k = 0;
+      }
+    }, merge, pool);
+  }
+
+  bool checkLast() const {
+    if(length == 0) {
+      return first == nullptr && last == nullptr;
+    }
+    const block* finalBlock = _findLast();
+    return (finalBlock == last && finalBlock->next == nullptr);
+  }
+};
+
+
+template<typename T, template<typename> class Alloc> struct alignas(64) unrolledList<T, Alloc>::block {
+  block* prev;
+  block* next;
+  size_t count;
+
+  // Links in the list's index, if it has one (see PositionIndex.hpp)
+  block* up;
+  block* left;
+  block* right;
+  size_t total;
+  uint32_t priority;
+
+  alignas(T) unsigned char storage[capacity * sizeof(T)];
+
+  block() : prev(nullptr), next(nullptr), count(0), up(nullptr), left(nullptr), right(nullptr), total(0), priority(0) {}
+
+  T* values() { return reinterpret_cast<T*>(storage); }
+  const T* values() const { return reinterpret_cast<const T*>(storage); }
+
+  void destroyValues() {
+    T* v = values();
+    for(size_t i = 0; i < count; ++i) {
+      v[i].~T();
+    }
+    count = 0;
+  }
+};
+
+template<typename T, template<typename> class Alloc> struct unrolledList<T, Alloc>::blockWeight {
+  static size_t of(const block* b) { return b->count; }
+};
+
+
+template<typename T, template<typename> class Alloc> class unrolledList<T, Alloc>::iterator {
+  using iterator_category = std::forward_iterator_tag;
+  friend class unrolledList;
+
+private:
+  block* ptr;
+  size_t offset;
+
+  iterator(block* const b, const size_t offset) : ptr(b), offset(offset) {}
+
+public:
+  iterator() : ptr(nullptr), offset(0) {}
+  iterator(std::nullptr_t) : ptr(nullptr), offset(0) {}
+
+  operator const_iterator() const { return const_iterator(ptr, offset); }
+
+  T& operator*() const { return ptr->values()[offset]; }
+  T* operator->() const { return ptr->values() + offset; }
+  T& value() const {
+    if(ptr == nullptr) throw std::runtime_error("Trying to access null iterator.");
+    return ptr->values()[offset];
+  }
+  T& nextValue() const { return *next(); }
+
+  iterator& operator++() {
+    if(ptr) {
+      _incrementBy(ptr, offset, 1);
+    }
+    return *this;
+  }
+  iterator operator++(int) {
+    iterator prev = *this;
+    if(ptr) {
+      _incrementBy(ptr, offset, 1);
+    }
+    return prev;
+  }
+  iterator next() const { return *this + 1; }
+
+  bool operator==(const iterator& other) const { return ptr == other.ptr && offset == other.offset; }
+  bool operator!=(const iterator& other) const { return !(*this == other); }
+  bool operator<(const iterator& other) const { return ptr < other.ptr || (ptr == other.ptr && offset < other.offset); }
+  bool operator>(const iterator& other) const { return other < *this; }
+
+  iterator operator+(int other) const { return *this + (size_t)other; }
+  iterator operator+(const size_t other) const {
+    iterator result = *this;
+    _advance(result.ptr, result.offset, other);
+    return result;
+  }
+
+  operator bool() const { return ptr != nullptr; }
+  bool isnull() const { return ptr == nullptr; }
+  bool valid() const { return ptr != nullptr; }
+  bool nextValid() const { return offset + 1 < ptr->count || ptr->next != nullptr; }
+
+  void clear() { ptr = nullptr; offset = 0; }
+};
+
+template<typename T, template<typename> class Alloc> class unrolledList<T, Alloc>::const_iterator {
+  using iterator_category = std::forward_iterator_tag;
+  friend class unrolledList;
+
+private:
+  const block* ptr;
+  size_t offset;
+
+  const_iterator(const block* const b, const size_t offset) : ptr(b), offset(offset) {}
+
+public:
+  const_iterator() : ptr(nullptr), offset(0) {}
+  const_iterator(std::nullptr_t) : ptr(nullptr), offset(0) {}
+
+  const_iterator(const iterator& other) : ptr(other.ptr), offset(other.offset) {}
+  const_iterator& operator=(const iterator& other) { ptr = other.ptr; offset = other.offset; return *this; }
+
+  const T& operator*() const { return ptr->values()[offset]; }
+  const T* operator->() const { return ptr->values() + offset; }
+
+  const_iterator& operator++() {
+    if(ptr) {
+      _incrementBy(ptr, offset, 1);
+    }
+    return *this;
+  }
+  const_iterator operator++(int) {
+    const_iterator prev = *this;
+    if(ptr) {
+      _incrementBy(ptr, offset, 1);
+    }
+    return prev;
+  }
+  const_iterator next() const { return *this + 1; }
+
+  bool operator==(const const_iterator& other) const { return ptr == other.ptr && offset == other.offset; }
+  bool operator!=(const const_iterator& other) const { return !(*this == other); }
+  bool operator<(const const_iterator& other) const { return ptr < other.ptr || (ptr == other.ptr && offset < other.offset); }
+  bool operator>(const const_iterator& other) const { return other < *this; }
+
+  const_iterator operator+(int other) const { return *this + (size_t)other; }
+  const_iterator operator+(const size_t other) const {
+    const_iterator result = *this;
+    _advance(result.ptr, result.offset, other);
+    return result;
+  }
+
+  operator bool() const { return ptr != nullptr; }
+  bool isnull() const { return ptr == nullptr; }
+  bool valid() const { return ptr != nullptr; }
+  bool nextValid() const { return offset + 1 < ptr->count || ptr->next != nullptr; }
+
+  const T& node() const {
+    if(ptr == nullptr) throw std::runtime_error("Trying to access null iterator.");
+    return ptr->values()[offset];
+  }
+
+  void clear() { ptr = nullptr; offset = 0; }
+};
+
+
+template<typename T, template<typename> class Alloc>
+class unrolledList<T, Alloc>::OutOfRange : public std::exception
+{
+  std::string msg;
+
+public:
+  OutOfRange() : msg("Unrolled List index out of range.") {}
+  OutOfRange(size_t containerSize, size_t requestedSize) : msg("Unrolled List index out of range.") {
+    msg += " Container size: " + std::to_string(containerSize);
+    msg += "; requested index: " + std::to_string(requestedSize);
+  }
+
+  virtual const char* what() const throw()
+  {
+    return msg.c_str();
+  }
+};
@@ -1,9 +1,12 @@
 #include <iostream>
-#include <chrono>
+#include <mutex>
+#include <memory>
 
 #include "LinkedList.hpp"
 #include "Analysis.cpp"
-
+#include "StageScheduler.hpp"
+#include "CelexAlphabet.hpp"
+#include "Metrics.hpp"
 
 
 int main() {
@@ -60,187 +63,215 @@ int main() {
   */
 
   const std::string sections = "0123";
-
-  const std::vector<Words::Replacement> replacements = {
-    Words::Replacement('R', "r"),
-    Words::Replacement('9', "u"),
-    Words::Replacement('H', "@n"),
-    Words::Replacement('P', "@l"),
-    Words::Replacement('~', "Q"),
-    Words::Replacement('q', "Q"),
-    Words::Replacement('x', "g"),
-    Words::Replacement('c', "I"),
-    Words::Replacement('0', "Q"),
-    Words::Replacement('F', "m"),
-    Words::Replacement('T', "D"),
-    Words::Replacement('Z', "zh"),
-    Words::Replacement('j', "Y"),
-    Words::Replacement('N', "Y"),
-    Words::Replacement('U', "@") };
-  
-  const std::string vowels = {
-    '@', 'I', '{', 'E', 'V',
-    'i', 'u', 'Q', '2', '1',
-    '5', '3', '#', '$', '6',
-    '8', '7', '4' };
-  const std::string consonants = {
-    't', 'n', 'r', 's', 'd',
-    'l', 'k', 'D', 'z', 'm',
-    'h', 'v', 'w', 'p', 'Y',
-    'b', 'f', 'S', 'g', 'J',
-    '_' };
-
-  std::chrono::high_resolution_clock::time_point start;
-  std::chrono::high_resolution_clock::time_point end;
-  int duration;
-
-  if(StringFunctions::contains(sections, '0')) {
-    Words input("data/CelexCountSylPron.txt");
-    
-    start = std::chrono::high_resolution_clock::now();
-    input.read();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Reading File. Duration: " << duration << "ms" << std::endl;
-
-    start = std::chrono::high_resolution_clock::now();
-    input.eliminate();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Removing Words. Duration: " << duration << "ms" << std::endl;
-
-    start = std::chrono::high_resolution_clock::now();
-    input.sort();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Time to sort: " << duration << "ms" << std::endl;
-
-    start = std::chrono::high_resolution_clock::now();
-    input.reverse();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Time to reverse: " << duration << "ms" << std::endl;
-
-    
-    input.checkLast();
-    list<Words::Info>::const_iterator i = input.getData().begin();
-    while(i + 1) {
-      ++i;
-    }
-    std::cout << "New Final Word: " << i.node().word << std::endl;
-
-    start = std::chrono::high_resolution_clock::now();
-    input.replacePron(replacements);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Replacing Phonemes. Duration: " << duration << "ms" << std::endl;
-
-    input.setPath("data/CuratedPronunciation.txt");
-    input.write();
-
-    std::cout << "Number of words: " << input.size() << std::endl;
-
-    Syllables sylCounts("data/SyllableCounts.txt");
-
-    start = std::chrono::high_resolution_clock::now();
-    sylCounts.import(input);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Converting Words to Syllables. Duration: " << duration << "ms" << std::endl;
-
-    int initialSylCount = sylCounts.size();
-    start = std::chrono::high_resolution_clock::now();
-    sylCounts.eliminate(vowels);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Removing Syllables. Removed " << initialSylCount - sylCounts.size() << ", Duration: " << duration << "ms" << std::endl;
-
-    start = std::chrono::high_resolution_clock::now();
-    sylCounts.sort();
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Sorting Syllables. Duration: " << duration << "ms" << std::endl;
-
-    if(!sylCounts.getData().checkLast()) {
-      throw std::runtime_error("After sorting not terminated by nullptr");
-    }
-
-    sylCounts.write();
-  }
-
+  // If set, section 0 applies this file of changes to the source data (see
+  // Words::applyDelta()) to the results of the last run, instead of reading
+  // all of it again, and sections 1 to 3 update their results to match.
+  // Applying it takes time in proportion to the delta, but the results are
+  // still read and written whole.
+  const std::string deltaPath = "";
+  const bool delta = !deltaPath.empty() && StringFunctions::contains(sections, '0');
+  // Skips the stages whose inputs and configuration are the same as when
+  // they last wrote their outputs (see StageScheduler)
+  const bool cache = true;
+  // Where the timings and counters of the run are written (see Metrics)
+  const std::string metricsPath = "data/Metrics.json";
+
+  // Lines from stages running at the same time are kept whole
+  std::mutex logMutex;
+  auto log = [&](const std::string& line) {
+    std::lock_guard<std::mutex> lock(logMutex);
+    std::cout << line << std::endl;
+  };
+
+  // Each section is split into stages named by the files they read and write,
+  // so the analyses that only need the syllable counts run at the same time.
+  StageScheduler stages;
+  stages.setCaching(cache);
 
   Syllables sylCounts("data/SyllableCounts.txt");
-  sylCounts.read();
-
-
-  if(StringFunctions::contains(sections, '1')) {
-    Phonemes phonemes("data/PhonemeCounts.txt");
-
-    start = std::chrono::high_resolution_clock::now();
-    phonemes.count(sylCounts);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Converting Syllables to Phonemes. Duration: " << duration << "ms" << std::endl;
-
-    phonemes.sort();
-    phonemes.write();
-
-
-    Blends blends("data/BlendCounts.txt");
-
-    start = std::chrono::high_resolution_clock::now();
-    blends.count(sylCounts, consonants);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Converting Syllables to Blends. Duration: " << duration << "ms" << std::endl;
-
-    blends.sort();
-    blends.write();
+  std::vector<Syllables::Change> changes; // Made by the delta
+
+  if(delta) {
+    stages.add("Apply delta", {deltaPath, "data/CuratedPronunciation.txt", "data/SyllableCounts.txt"}, {"data/CuratedPronunciation.txt", "data/SyllableCounts.txt", "syllables", "syllable changes"}, [&]() {
+      Words input("data/CuratedPronunciation.txt");
+      std::vector<Words::Change> wordChanges;
+
+      input.read();
+      sylCounts.read();
+      input.applyDelta(deltaPath, celex, wordChanges);
+      changes = sylCounts.applyDelta(input, wordChanges, vowels);
+      log("Changed " + std::to_string(changes.size()) + " Syllables");
+      log("Number of words: " + std::to_string(input.size()));
+
+      input.write(true);
+      sylCounts.write(true);
+    });
+  } else if(StringFunctions::contains(sections, '0')) {
+    stages.add("Curate words", {"data/CelexCountSylPron.txt"}, {"data/CuratedPronunciation.txt", "data/SyllableCounts.txt"}, [&]() {
+      Words input("data/CelexCountSylPron.txt");
+      std::vector<int> counts; // How often each syllable is used, by pronunciation ID
+
+      input.readAndCurate(celex, counts);
+      input.sort();
+      input.reverse();
+
+      input.checkLast();
+      unrolledList<Words::Info, poolAllocator>::const_iterator i = input.getData().begin();
+      while(i + 1) {
+        ++i;
+      }
+      log("New Final Word: " + i.node().word);
+
+      input.setPath("data/CuratedPronunciation.txt");
+      input.write(true);
+
+      log("Number of words: " + std::to_string(input.size()));
+
+      Syllables sylCounts("data/SyllableCounts.txt");
+      sylCounts.importCounts(input, counts);
+      sylCounts.eliminate(vowels);
+      sylCounts.sort();
+
+      if(!sylCounts.getData().checkLast()) {
+        throw std::runtime_error("After sorting not terminated by nullptr");
+      }
+
+      sylCounts.write(true);
+    }, celex.toString());
   }
 
-  if(StringFunctions::contains(sections, '2')) {
-    Positional ps;
 
-    start = std::chrono::high_resolution_clock::now();
-    ps.count(sylCounts, consonants);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Counting Consonant Positions. Duration: " << duration << "ms" << std::endl;
+  if(!delta && (StringFunctions::contains(sections, '1') || StringFunctions::contains(sections, '2') || StringFunctions::contains(sections, '3'))) {
+    stages.add("Read syllables", {"data/SyllableCounts.txt"}, {"syllables"}, [&]() {
+      sylCounts.read();
+    });
+  }
 
-    ps.setPath("data/StartPosFreqs.txt");
-    ps.sortByStart();
-    ps.write(true, false);
 
-    ps.setPath("data/EndPosFreqs.txt");
-    ps.sortByEnd();
-    ps.write(false, true);
+  if(StringFunctions::contains(sections, '1') && delta) {
+    stages.add("Phonemes", {"syllable changes", "data/PhonemeCounts.txt"}, {"data/PhonemeCounts.txt"}, [&]() {
+      Phonemes phonemes("data/PhonemeCounts.txt");
+      phonemes.read();
+      phonemes.update(changes);
+      phonemes.sort();
+      phonemes.write();
+    });
+  } else if(StringFunctions::contains(sections, '1')) {
+    stages.add("Phonemes", {"syllables"}, {"data/PhonemeCounts.txt"}, [&]() {
+      Phonemes phonemes("data/PhonemeCounts.txt");
+      phonemes.count(sylCounts);
+      phonemes.sort();
+      phonemes.write();
+    });
   }
 
-  
-  if(StringFunctions::contains(sections, '3')) {
-    Overlap vOverlap("data/VowelOverlap.csv");
+  if(StringFunctions::contains(sections, '1') && delta) {
+    stages.add("Blends", {"syllables", "syllable changes", "data/BlendPositions.txt"}, {"data/BlendCounts.txt", "data/BlendPositions.txt"}, [&]() {
+      Blends blends("data/BlendPositions.txt");
+      blends.read();
+      blends.update(changes, sylCounts, consonants);
+
+      blends.setPath("data/BlendCounts.txt");
+      blends.write();
+      blends.setPath("data/BlendPositions.txt");
+      blends.write(true, true, true);
+    });
+  } else if(StringFunctions::contains(sections, '1')) {
+    stages.add("Blends", {"syllables"}, {"data/BlendCounts.txt", "data/BlendPositions.txt"}, [&]() {
+      Blends blends("data/BlendCounts.txt");
+      blends.count(sylCounts, consonants);
+      blends.sort();
+      blends.write();
+
+      blends.setPath("data/BlendPositions.txt");
+      blends.write(true, true, true);
+    }, std::string(consonants.phonemes()));
+  }
 
-    start = std::chrono::high_resolution_clock::now();
-    vOverlap.count(sylCounts, vowels);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Counting Vowel Overlap. Duration: " << duration << "ms" << std::endl;
+  if(StringFunctions::contains(sections, '2') && delta) {
+    stages.add("Positional", {"syllable changes", "data/StartPosFreqs.txt", "data/EndPosFreqs.txt"}, {"data/StartPosFreqs.txt", "data/EndPosFreqs.txt"}, [&]() {
+      Positional ps;
+      ps.setPath("data/StartPosFreqs.txt");
+      ps.read(true, false);
+      ps.setPath("data/EndPosFreqs.txt");
+      ps.read(false, true);
+
+      ps.update(changes, consonants);
+
+      ps.setPath("data/StartPosFreqs.txt");
+      ps.sortByStart();
+      ps.write(true, false);
+
+      ps.setPath("data/EndPosFreqs.txt");
+      ps.sortByEnd();
+      ps.write(false, true);
+    });
+  } else if(StringFunctions::contains(sections, '2')) {
+    stages.add("Positional", {"syllables"}, {"data/StartPosFreqs.txt", "data/EndPosFreqs.txt"}, [&]() {
+      Positional ps;
+      ps.count(sylCounts, consonants);
+
+      ps.setPath("data/StartPosFreqs.txt");
+      ps.sortByStart();
+      ps.write(true, false);
+
+      ps.setPath("data/EndPosFreqs.txt");
+      ps.sortByEnd();
+      ps.write(false, true);
+    }, std::string(consonants.phonemes()));
+  }
 
-    vOverlap.write();
 
-    Overlap cOverlap("data/ConsonantOverlap.csv");
+  std::unique_ptr<Substitutions> substitutions;
+  if(StringFunctions::contains(sections, '3') && delta) {
+    stages.add("Vowel overlap", {"syllables", "syllable changes", "data/VowelOverlap.csv"}, {"data/VowelOverlap.csv"}, [&]() {
+      Overlap vOverlap("data/VowelOverlap.csv");
+      vOverlap.read(vowels);
+      vOverlap.update(changes, sylCounts);
+      vOverlap.write(true);
+    });
+
+    stages.add("Consonant overlap", {"syllables", "syllable changes", "data/ConsonantOverlap.csv"}, {"data/ConsonantOverlap.csv"}, [&]() {
+      Overlap cOverlap("data/ConsonantOverlap.csv");
+      cOverlap.read(consonants);
+      cOverlap.update(changes, sylCounts);
+      cOverlap.write(true);
+    });
+  } else if(StringFunctions::contains(sections, '3')) {
+    stages.add("Substitutions", {"syllables"}, {"substitutions"}, [&]() {
+      substitutions = std::make_unique<Substitutions>(sylCounts);
+    });
+
+    stages.add("Vowel overlap", {"substitutions"}, {"data/VowelOverlap.csv"}, [&]() {
+      Overlap vOverlap("data/VowelOverlap.csv");
+      vOverlap.count<vowels>(*substitutions);
+      vOverlap.write(true);
+    }, std::string(vowels.phonemes()));
+
+    stages.add("Consonant overlap", {"substitutions"}, {"data/ConsonantOverlap.csv"}, [&]() {
+      Overlap cOverlap("data/ConsonantOverlap.csv");
+      cOverlap.count<consonants>(*substitutions);
+      cOverlap.write(true);
+    }, std::string(consonants.phonemes()));
+  }
 
-    start = std::chrono::high_resolution_clock::now();
-    cOverlap.count(sylCounts, consonants);
-    end = std::chrono::high_resolution_clock::now();
-    duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cout << "Finished Counting Consonant Overlap. Duration: " << duration << "ms" << std::endl;
 
-    cOverlap.write();
+  {
+    Metrics::Timer timer("Run stages");
+    stages.run(ThreadPool::shared());
+  }
+  std::cout << Metrics::shared().toString();
+  for(const StageScheduler::Stage& stage : stages.getStages()) {
+    if(stage.upToDate) {
+      std::cout << "  " << stage.name << ": Up to date" << std::endl;
+    }
+  }
+  if(!Metrics::shared().writeJSON(metricsPath)) {
+    std::cout << "Could not write " << metricsPath << std::endl;
   }
 
 
   std::cout << "Hello World!" << std::endl;
   
   return 0;
-}
\ No newline at end of file
+}